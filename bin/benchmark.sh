@@ -0,0 +1,160 @@
+#! /bin/bash
+
+# Runs preprocessing and alignment on every bundled model/log pair, and
+# records wall time and peak memory of each phase, and alignment cost
+# (with the cost of the reference alignments in data/alignments).
+#
+#  Usage :  ./benchmark.sh [-o report] [-b baseline] configfile ["model1 model2 .."]
+#
+#    Models default to all logs in data/logs with a model in data/originals.
+#    The report has one "model metric value" line per measure (default
+#    data/benchmark/report.tsv).  It is compared with the baseline report
+#    (default data/benchmark/baseline.tsv), and measures that got worse are
+#    flagged: times or memory more than $TOLERANCE % higher (default 20, and
+#    at least 0.05s or 10MB, to ignore noise on tiny runs), or a higher
+#    alignment cost.  Exit status is 1 if any was flagged.
+#    If there is no baseline yet, the report is saved as baseline.
+#    Exit status is 2 if no model could be benchmarked.
+#    Wall time and peak memory are measured by bin/runstat (built with the
+#    other programs in src).
+#
+#  e.g.  bin/benchmark.sh config/config.15.5.-100.-150.-300.cfg "M1 M4 ML3"
+
+BINDIR=`cd \`dirname $0\`; pwd`
+ROOTDIR=`dirname $BINDIR`
+DATADIR=$ROOTDIR/data
+
+REPORT=$DATADIR/benchmark/report.tsv
+BASELINE=$DATADIR/benchmark/baseline.tsv
+while [ $# -gt 0 ]; do
+    case $1 in
+        -o) REPORT=$2; shift 2 ;;
+        -b) BASELINE=$2; shift 2 ;;
+        *) break ;;
+    esac
+done
+
+CONFIG=$1
+MODELS=$2
+TOLERANCE=${TOLERANCE:-20}
+if [ -z "$CONFIG" ]; then
+    echo "Usage: $0 [-o report] [-b baseline] configfile [\"model1 model2 ..\"]" >&2
+    exit 2
+fi
+if [ ! -x $BINDIR/runstat ]; then
+    echo "$BINDIR/runstat not found, compile the programs in src first" >&2
+    exit 2
+fi
+
+if [ -z "$MODELS" ]; then
+    for log in $DATADIR/logs/*.xes; do
+        name=`basename $log .xes`
+        if ls $DATADIR/originals/*/$name.pnml >/dev/null 2>&1; then MODELS="$MODELS $name"; fi
+    done
+fi
+
+WORK=$DATADIR/benchmark/work
+rm -rf $WORK
+mkdir -p $WORK `dirname $REPORT`
+rm -f $REPORT
+
+# same configuration, with run statistics (needed for the time of each align phase)
+grep -v '^Statistics' $CONFIG > $WORK/bench.cfg
+echo "Statistics true" >> $WORK/bench.cfg
+
+report() {
+    echo "$1 $2 $3" >> $REPORT
+}
+
+### run a phase of a model, recording its wall time and peak RSS (in KB,
+### as the kernel accounts it when the command ends).
+###   usage: run_phase model phase stdoutfile command args..
+run_phase() {
+    local model=$1 phase=$2 out=$3
+    shift 3
+    local wall rss
+    $BINDIR/runstat -o $WORK/phase.time "$@" > $out 2>>$WORK/$model.err
+    read wall rss < $WORK/phase.time
+    report $model $phase.wall $wall
+    report $model $phase.rss_kb $rss
+}
+
+### average cost of reference alignments of a model (ProM or ILPSDP csv files)
+reference_cost() {
+    local csv=$1
+    if [ "${csv%.gz}" != "$csv" ]; then zcat $csv > $WORK/ref.csv; csv=$WORK/ref.csv; fi
+    if [ "`head -1 $csv | cut -c1-8`" == "Case_id;" ]; then
+        # ILPSDP: case ids separated by ',', moves [L] [M] and [L/M]
+        awk -F';' 'NR>1 {n=split($1,ids,","); x=gsub("\\[M\\]","[X]",$NF)+gsub("\\[L\\]","[X]",$NF); cost+=n*x; cases+=n}
+                   END {if (cases>0) print cost/cases}' $csv
+    else
+        (cd $WORK; $BINDIR/eval-prom.sh < $csv) | awk '/av.cost/ {print $3}'
+    fi
+}
+
+for name in $MODELS; do
+    echo "BENCHMARKING $name" >&2
+    ORIGINAL=`ls $DATADIR/originals/*/$name.pnml 2>/dev/null | head -1`
+    LOG=$DATADIR/logs/$name.xes
+    UNF=$WORK/$name.bp.pnml
+
+    ### unfolding: computed if punf is available, else taken from data/unfoldings
+    if [ -x $BINDIR/punf -a -n "$ORIGINAL" ]; then
+        run_phase $name unfold /dev/null $BINDIR/punf -f=$ORIGINAL -m=$UNF
+        sed -i 's/+complete//g' $UNF
+    elif [ -f $DATADIR/unfoldings/$name.bp.pnml ]; then
+        cp $DATADIR/unfoldings/$name.bp.pnml $UNF
+    else
+        echo "  no unfolding for $name (punf not found in $BINDIR, and not in $DATADIR/unfoldings), skipped" >&2
+        continue
+    fi
+
+    ### shortest paths and behavioral profiles, for both unfoldings (normal and reconnected)
+    run_phase $name paths.tt $WORK/$name.tt.path $BINDIR/paths $UNF unfolding true true
+    run_phase $name paths.tf $WORK/$name.tf.path $BINDIR/paths $UNF unfolding true false
+    run_phase $name bps.tt $WORK/$name.tt.bp $BINDIR/compute-bps $UNF unfolding true true
+    run_phase $name bps.tf $WORK/$name.tf.bp $BINDIR/compute-bps $UNF unfolding true false
+
+    ### alignment, and the time of its phases as printed by align
+    run_phase $name align $WORK/$name.out $BINDIR/align $WORK/$name $LOG $WORK/bench.cfg
+    awk '/^STATS: wall time:/ {gsub("s,","",$0); gsub("s$","",$0); print "'$name' align.model_load.wall",$6; print "'$name' align.log_load.wall",$9; print "'$name' align.solve.wall",$11}' $WORK/$name.err >> $REPORT
+
+    report $name cost.RL `$BINDIR/eval-relax.sh < $WORK/$name.out | awk '/av.cost/ {print $3}'`
+    for ref in ILPSDP ProM-Astar ProM-RuR; do
+        csv=`ls $DATADIR/alignments/$ref/$name.csv* 2>/dev/null | head -1`
+        if [ -n "$csv" ]; then report $name cost.$ref `reference_cost $csv`; fi
+    done
+done
+
+if [ ! -s $REPORT ]; then
+    echo "No model was benchmarked, no report written" >&2
+    exit 2
+fi
+echo "Report written to $REPORT" >&2
+
+if [ ! -f $BASELINE ]; then
+    mkdir -p `dirname $BASELINE`
+    if ! cp $REPORT $BASELINE; then
+        echo "Error saving report as baseline $BASELINE" >&2
+        exit 2
+    fi
+    echo "No baseline found, report saved as baseline $BASELINE" >&2
+    exit 0
+fi
+
+### compare with baseline. Reference costs are not ours, so they are not compared
+awk -v tol=$TOLERANCE '
+  FNR==NR {base[$1" "$2]=$3; next}
+  $2 ~ /^cost\.(ILPSDP|ProM)/ {next}
+  !(($1" "$2) in base) {printf("%-12s %-24s %12s %12s\n", $1, $2, "-", $3); next}
+  {
+    b = base[$1" "$2]; flag = "";
+    if ($2 ~ /^cost/) { if ($3 > b+1e-9) flag = "REGRESSION"; }
+    else if ($2 ~ /wall$/) { if ($3 > b*(1+tol/100) && $3-b > 0.05) flag = "REGRESSION"; }
+    else if ($3 > b*(1+tol/100) && $3-b > 10240) flag = "REGRESSION";
+    change = (b!=0 ? sprintf("%+.1f%%", 100*($3-b)/b) : "");
+    printf("%-12s %-24s %12s %12s %8s %s\n", $1, $2, b, $3, change, flag);
+    if (flag != "") bad++;
+  }
+  END { if (bad>0) { print bad" measures got worse than baseline" > "/dev/stderr"; exit 1 } }
+' $BASELINE $REPORT
@@ -16,9 +16,14 @@ OUTNAME=`basename $CONFIG | cut -d'.' -f2-6`
 rm -rf $DATADIR/results/output.$OUTNAME
 mkdir -p $DATADIR/results/output.$OUTNAME
 
-# launch processes to align all models
+# all models are aligned by a single align-batch process, sharing
+# its workers (one per core, or $WORKERS if set)
+MANIFEST=$DATADIR/results/output.$OUTNAME/manifest.txt
 for x in $MODELS; do
     name=`basename $x .bp.pnml`
-    echo "Aligning $name" >&2
-    $BINDIR/align $DATADIR/unfoldings/$name $DATADIR/logs/$name.xes $CONFIG  > $DATADIR/results/output.$OUTNAME/$name.out 
+    # use the binary log created by compile-log, if it is up to date
+    log=$DATADIR/logs/$name.xes
+    if [ $DATADIR/logs/$name.rlog -nt $log ]; then log=$DATADIR/logs/$name.rlog; fi
+    echo "$DATADIR/unfoldings/$name $log $CONFIG $DATADIR/results/output.$OUTNAME/$name.out" >> $MANIFEST
 done
+$BINDIR/align-batch -w ${WORKERS:-0} $MANIFEST > $DATADIR/results/output.$OUTNAME/timing.txt
@@ -0,0 +1,12 @@
+#! /bin/bash
+
+### Converts alignments written with "OutputFormat compact" to the usual text format (one line per case)
+
+## Usage:  ./expand-output.sh < output-file
+##         cat output-file | ./expand-output.sh | ./eval-relax.sh
+
+## Variant lines are "@k alignment fitting time", where the alignment may be
+## empty (only three fields); case lines are "case-id @k".
+
+awk '$1 ~ /^@[0-9]+$/ && NF>=3 {a[$1]=(NF>3 ? $2 : ""); f[$1]=$(NF-1); t[$1]=$NF; next}
+     {print $1"  "a[$2]" "f[$2]" "t[$2]; t[$2]=0}'
@@ -0,0 +1,67 @@
+#! /bin/bash
+
+# Measures the cost of the tracing code: builds the programs twice, with
+# all trace levels compiled in (default, debug build) and with the given
+# compile-time limit (production build, see src/traces.h), and compares
+# the time of the main kernels (src/microbench) and of a full align run,
+# with tracing off in both.
+#
+#  Usage :  ./trace-overhead.sh model-prefix traces config ["trace flags"]
+#
+#    Trace flags default to -DTRACE_MAX_LEVEL=0.  Builds are made in a
+#    temporary directory, so the source tree is not touched.
+#
+#  e.g.  bin/trace-overhead.sh data/unfoldings/M4 data/logs/M4.xes config/config.15.5.-100.-150.-300.cfg
+
+BINDIR=`cd \`dirname $0\`; pwd`
+SRCDIR=`dirname $BINDIR`/src
+
+MODEL=$1
+LOG=$2
+CONFIG=$3
+TRACE_FLAGS=${4:--DTRACE_MAX_LEVEL=0}
+if [ -z "$CONFIG" ]; then
+    echo "Usage: $0 model-prefix traces config [\"trace flags\"]" >&2
+    exit 2
+fi
+
+WORK=`mktemp -d`
+trap "rm -rf $WORK" EXIT
+
+### build a copy of the sources with given trace flags
+build() {
+    local dir=$WORK/$1
+    mkdir -p $dir/bin
+    cp -r $SRCDIR $dir/src
+    (cd $dir/src; make clean >/dev/null; make TRACE_FLAGS="$2" align microbench >/dev/null 2>$dir/build.err)
+    if [ $? -ne 0 ]; then
+        echo "Build with TRACE_FLAGS='$2' failed:" >&2
+        cat $dir/build.err >&2
+        exit 1
+    fi
+}
+
+echo "Building debug version (all traces)..." >&2
+build debug ""
+echo "Building production version ($TRACE_FLAGS)..." >&2
+build prod "$TRACE_FLAGS"
+
+### kernels: median ns/op of each build
+for v in debug prod; do
+    $WORK/$v/src/microbench $MODEL $LOG $CONFIG solve add_constraints find_path possible_transitions 2>/dev/null \
+        | awk '!/^#/ {print $1, $3}' > $WORK/$v.kernels
+done
+
+### full run: wall time of the alignment phase
+cfg=$WORK/stats.cfg
+grep -v '^Statistics' $CONFIG > $cfg
+echo "Statistics true" >> $cfg
+for v in debug prod; do
+    $WORK/$v/src/align $MODEL $LOG $cfg 2>&1 >/dev/null \
+        | awk '/^STATS: wall time:/ {gsub("s$","",$0); print "align(s)", $11}' >> $WORK/$v.kernels
+done
+
+echo "# production build: $TRACE_FLAGS"
+printf "%-24s %14s %14s %8s\n" "# kernel" "debug" "production" "change"
+paste -d' ' $WORK/debug.kernels $WORK/prod.kernels \
+    | awk '{printf "%-24s %14s %14s %+7.1f%%\n", $1, $2, $4, ($2>0 ? 100*($4-$2)/$2 : 0)}'
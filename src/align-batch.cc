@@ -0,0 +1,330 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include "aligner.h"
+#include "log.h"
+#include "output.h"
+#include "pool.h"
+#include "timeline.h"
+#include "traces.h"
+#define MOD_TRACENAME "BATCH"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+///////////////////////////////////////////////////////
+/// An alignment job from the manifest: a model and a log, 
+/// aligned with a configuration, and written to an output file
+
+class job {
+ public:
+  typedef enum {WAITING, LOADING, READY} state_type;
+
+  /// manifest line and fields
+  int line;
+  string basename, ftrace, fconfig, fout;
+  state_type state;
+
+  /// model and log, while the job is running
+  unique_ptr<model> m;
+  unique_ptr<trace_log> log;
+  /// variants to align, in output order, next one to hand out, and number aligned
+  vector<uint32_t> variants;
+  size_t next, done;
+  /// result of each variant: alignment, whether it fits, and CPU time
+  vector<string> solution;
+  vector<bool> fits;
+  vector<double> time;
+  /// aligner of each worker, created when the worker first takes a variant of this job
+  vector<unique_ptr<aligner>> aligners;
+
+  /// timing summary: load time, CPU time spent aligning, finish time since
+  /// start (wall clock, seconds), and RL iterations
+  double load_time, align_time, finish_time;
+  long iterations;
+  size_t ncases, nvariants;
+
+  job(int ln, const string &bn, const string &ft, const string &fc, const string &fo) :
+    line(ln), basename(bn), ftrace(ft), fconfig(fc), fout(fo), state(WAITING), next(0), done(0),
+    load_time(0), align_time(0), finish_time(0), iterations(0), ncases(0), nvariants(0) {}
+};
+
+///////////////////////////////////////////////////////
+/// A step of a job handed to a worker: loading the job, or aligning one of its variants
+
+class step {
+ public:
+  job *j;
+  bool load;
+  size_t index;
+};
+
+///////////////////////////////////////////////////////
+/// Hands out job steps to workers.  Jobs are loaded first, as 
+/// soon as a worker is free.  Then each variant goes to the 
+/// ready job that has used less CPU time so far, so jobs progress
+/// at the same pace and a huge log does not starve small ones.
+
+class scheduler {
+ private:
+  vector<unique_ptr<job>> &jobs;
+  mutex mtx;
+  condition_variable changed;
+
+ public:
+  scheduler(vector<unique_ptr<job>> &js) : jobs(js) {}
+
+  /// next step for a worker. Waits while jobs are loading and there is 
+  /// nothing else to do. Returns false when no work is left
+  bool next(step &s) {
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+      bool loading = false;
+      job *best = NULL;
+      for (auto &j : jobs) {
+        if (j->state==job::WAITING) {
+          j->state = job::LOADING;
+          s.j = j.get();
+          s.load = true;
+          return true;
+        }
+        loading = loading or j->state==job::LOADING;
+        if (j->state==job::READY and j->next<j->variants.size() 
+            and (best==NULL or j->align_time<best->align_time)) 
+          best = j.get();
+      }
+
+      if (best!=NULL) {
+        s.j = best;
+        s.load = false;
+        s.index = best->next++;
+        return true;
+      }
+      if (not loading) return false;
+      changed.wait(lock);
+    }
+  }
+
+  /// a job finished loading
+  void loaded(job *j) {
+    lock_guard<mutex> lock(mtx);
+    j->state = job::READY;
+    changed.notify_all();
+  }
+
+  /// a variant was aligned. Returns true if it was the last one of its job
+  bool aligned(const step &s, const string &solution, bool fits, double time) {
+    lock_guard<mutex> lock(mtx);
+    job *j = s.j;
+    j->solution[s.index] = solution;
+    j->fits[s.index] = fits;
+    j->time[s.index] = time;
+    j->align_time += time;
+    return ++j->done == j->variants.size();
+  }
+};
+
+
+///////////////////////////////////////////////////////
+/// CPU time used by the calling thread, in seconds
+
+double thread_time() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+///////////////////////////////////////////////////////
+/// load model and log of a job, warning about events with no
+/// matching task in the model
+
+void load_job(job &j, int nworkers) {
+  timeline::scope ts("load job", j.line);
+  auto t0 = chrono::steady_clock::now();
+
+  TRACE(1, "Loading model " << j.basename);
+  j.m.reset(new model(j.basename, j.fconfig));
+  TRACE(1, "Loading trace file " << j.ftrace);
+  j.log.reset(new trace_log());
+  j.log->load(j.ftrace, j.m->cfg.LOAD_THREADS);
+
+  map<string,uint64_t> warned;
+  for (uint32_t a=0; a<j.log->num_activities(); ++a) 
+    if (j.m->g.get_nodes_by_name(j.log->get_activity(a)).empty()) 
+      warned.insert(make_pair(j.log->get_activity(a), j.log->get_activity_count(a)));
+  for (auto w : warned) {
+    WARNING("WARNING: " << j.ftrace << ": Event name '"<<w.first<<"' occurred "<<w.second<<" times in the log, but no matching model task was found.");
+  }
+
+  j.variants = j.log->by_name();
+  j.ncases = j.log->num_cases();
+  j.nvariants = j.variants.size();
+  j.solution.assign(j.nvariants, "");
+  j.fits.assign(j.nvariants, false);
+  j.time.assign(j.nvariants, 0.0);
+  j.aligners.resize(nworkers);
+
+  chrono::duration<double> t = chrono::steady_clock::now() - t0;
+  j.load_time = t.count();
+  TRACE(1, "Loaded " << j.ncases << " traces, " << j.nvariants << " variants from " << j.ftrace);
+}
+
+///////////////////////////////////////////////////////
+/// write the results of a finished job, and release its model and log
+
+void finish_job(job &j, chrono::steady_clock::time_point start) {
+
+  timeline::scope ts("finish job", j.line);
+  FILE *f = fopen(j.fout.c_str(), "w");
+  if (f==NULL) ERROR_CRASH("Error opening output file " << j.fout);
+  {
+    result_writer writer(f, result_writer::format(j.m->cfg.OUTPUT_FORMAT), j.m->g, *j.log);
+    for (size_t i=0; i<j.variants.size(); ++i)
+      writer.write(j.solution[i], fitting_name(j.fits[i]), j.time[i], j.log->get_cases(j.variants[i]));
+  }
+  fclose(f);
+
+  for (auto &a : j.aligners) 
+    if (a!=NULL) j.iterations += a->get_iterations();
+
+  // aligners refer to the model, so they go first
+  j.aligners.clear();
+  j.m.reset();
+  j.log.reset();
+  vector<string>().swap(j.solution);
+
+  chrono::duration<double> t = chrono::steady_clock::now() - start;
+  j.finish_time = t.count();
+  cerr << "Finished " << j.basename << " " << j.ftrace << ": " << j.nvariants << " variants in " 
+       << j.align_time << "s, output in " << j.fout << endl;
+}
+
+///////////////////////////////////////////////////////
+/// read the manifest: one job per line, "model-prefix traces config output".
+/// Empty lines and lines starting with '#' are ignored
+
+vector<unique_ptr<job>> read_manifest(const string &fname) {
+  ifstream fin(fname);
+  if (not fin.good()) ERROR_CRASH("Error opening manifest " << fname);
+
+  vector<unique_ptr<job>> jobs;
+  string line;
+  int n = 0;
+  while (getline(fin, line)) {
+    ++n;
+    istringstream sin(line);
+    string basename, ftrace, fconfig, fout, extra;
+    sin >> basename;
+    if (basename.empty() or basename[0]=='#') continue;
+    sin >> ftrace >> fconfig >> fout;
+    if (fout.empty() or (sin >> extra)) 
+      ERROR_CRASH(fname << " line " << n << ": expected 'model-prefix traces config output'");
+
+    // check files now, rather than failing after other jobs ran
+    if (not model::available(basename, fconfig)) 
+      ERROR_CRASH(fname << " line " << n << ": missing model files " << basename << ".* or config file " << fconfig);
+    if (not ifstream(ftrace).good()) 
+      ERROR_CRASH(fname << " line " << n << ": error opening trace file " << ftrace);
+
+    jobs.push_back(unique_ptr<job>(new job(n, basename, ftrace, fconfig, fout)));
+  }
+  return jobs;
+}
+
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  int nworkers = 0;
+  string fmanifest;
+  string tracing;
+  string ftimeline;
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    if (arg=="-w" and i+1<argc) nworkers = atoi(argv[++i]);
+    else if (arg=="-t" and i+1<argc) ftimeline = argv[++i];
+    else if (arg[0]!='-' and fmanifest.empty()) fmanifest = arg;
+    else if (arg[0]!='-' and tracing.empty()) tracing = arg;
+    else fmanifest.clear();
+  }
+  if (fmanifest.empty()) {
+    ERROR_CRASH("Usage " << argv[0] << " [-w workers] [-t timeline.json] manifest [tracingoptions]\n         Runs all alignment jobs in manifest, one per line: model-prefix traces config output\n         With -t, a timeline of the run is saved in Chrome trace format\n         tracingoptions format is level:hexmask. eg. 4:0x103");
+  }
+
+  traces::set_tracing(tracing);
+  if (not ftimeline.empty()) timeline::start();
+
+  vector<unique_ptr<job>> jobs = read_manifest(fmanifest);
+  auto start = chrono::steady_clock::now();
+
+  // all jobs share the same workers. Each worker takes steps until none are left
+  worker_pool pool(nworkers);
+  scheduler sched(jobs);
+  for (int w=0; w<pool.size(); ++w) {
+    pool.submit([&sched, &pool, start](int w) {
+        step s;
+        while (sched.next(s)) {
+          job &j = *s.j;
+          if (s.load) {
+            load_job(j, pool.size());
+            if (j.variants.empty()) finish_job(j, start);
+            sched.loaded(&j);
+            continue;
+          }
+
+          TRACE(0, "ALIGNING TRACE " << j.log->get_cases(j.variants[s.index])[0] << " (and synonyms) of " << j.ftrace);
+          if (j.aligners[w]==NULL) j.aligners[w].reset(new aligner(*j.m));
+          double t0 = thread_time();
+          bool fits;
+          string solution;
+          {
+            timeline::scope ts("align variant", j.line);
+            solution = j.aligners[w]->align(j.log->get_variant(j.variants[s.index]), fits).dump();
+          }
+          if (sched.aligned(s, solution, fits, thread_time()-t0)) finish_job(j, start);
+        }
+      });
+  }
+  pool.wait();
+  if (not ftimeline.empty()) timeline::save(ftimeline);
+
+  // timing summary
+  cout << "# line model traces cases variants load(s) align(s) finished(s) RL-iterations output" << endl;
+  for (auto &j : jobs) 
+    cout << j->line << " " << j->basename << " " << j->ftrace << " " << j->ncases << " " << j->nvariants << " "
+         << j->load_time << " " << j->align_time << " " << j->finish_time << " " << j->iterations << " " << j->fout << endl;
+}
@@ -0,0 +1,399 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <map>
+#include <deque>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "aligner.h"
+#include "pool.h"
+#include "traces.h"
+#define MOD_TRACENAME "SERVER"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+///////////////////////////////////////////////////////
+/// A loaded model, with an aligner for each worker
+
+class entry {
+ public:
+  model m;
+  vector<unique_ptr<aligner>> aligners;
+
+  entry(const string &basename, const string &fconfig, int nworkers) : m(basename, fconfig) {
+    for (int w=0; w<nworkers; ++w) aligners.push_back(unique_ptr<aligner>(new aligner(m)));
+  }
+};
+
+///////////////////////////////////////////////////////
+/// An open case, aligned online one event at a time. Its events
+/// are queued, and handled in order by one worker at a time.
+
+class open_case {
+ public:
+  shared_ptr<entry> e;
+  online_case oc;
+  mutex mtx;
+  deque<string> events;
+  bool closing, scheduled;
+
+  open_case(shared_ptr<entry> en) : e(en), oc(en->m), closing(false), scheduled(false) {}
+};
+
+///////////////////////////////////////////////////////
+/// A client session: request and reply streams, open cases, and
+/// tasks of the session queued or running in the shared pool.
+/// Replies may come from several workers, so they are serialized.
+/// Once a reply can not be written (the client went away), the
+/// session is dead: later replies are dropped, and pending work skipped.
+
+class session {
+ public:
+  FILE *in, *out;
+  mutex mtx;
+  map<string,shared_ptr<open_case>> cases;
+  int pending;
+  condition_variable idle;
+  bool dead;
+
+  session(FILE *i, FILE *o) : in(i), out(o), pending(0), dead(false) {}
+  ~session() {
+    if (in!=stdin) fclose(in);
+    if (out!=stdout) fclose(out);
+  }
+
+  void reply(const string &s) {
+    lock_guard<mutex> lock(mtx);
+    if (dead) return;
+    if (fputs(s.c_str(), out)==EOF or fputc('\n', out)==EOF or fflush(out)!=0) {
+      TRACE(1, "Client went away: " << strerror(errno));
+      dead = true;
+    }
+  }
+
+  /// check whether the client went away
+  bool closed() {
+    lock_guard<mutex> lock(mtx);
+    return dead;
+  }
+
+  /// a task of the session was queued, or finished
+  void started() {
+    lock_guard<mutex> lock(mtx);
+    ++pending;
+  }
+  void finished() {
+    lock_guard<mutex> lock(mtx);
+    if (--pending == 0) idle.notify_all();
+  }
+  /// wait until all tasks of the session are finished (other sessions may still be busy)
+  void wait() {
+    unique_lock<mutex> lock(mtx);
+    idle.wait(lock, [this]{ return pending==0; });
+  }
+};
+
+// loaded models, by name. Requests hold a reference to the model
+// they use, so it can be replaced or unloaded while they run.
+map<string,shared_ptr<entry>> registry;
+mutex registry_mtx;
+
+// workers solving alignment requests
+worker_pool *pool;
+
+
+///////////////////////////////////////////////////////
+/// find a loaded model by name (NULL if not loaded)
+
+shared_ptr<entry> find_model(const string &name) {
+  lock_guard<mutex> lock(registry_mtx);
+  auto p = registry.find(name);
+  return (p==registry.end() ? NULL : p->second);
+}
+
+///////////////////////////////////////////////////////
+/// handle queued events of an open case, replying the provisional
+/// alignment after each one.  If the case is closing and no events
+/// are left, reply its final alignment.
+
+void handle_case(shared_ptr<session> ss, const string &id, shared_ptr<open_case> c) {
+
+  while (true) {
+    string ev;
+    {
+      lock_guard<mutex> lock(c->mtx);
+      if (ss->closed()) c->events.clear();  // nobody will read the replies
+      if (c->events.empty()) {
+        if (c->closing and not ss->closed()) break;
+        c->scheduled = false;
+        return;
+      }
+      ev = c->events.front();
+      c->events.pop_front();
+    }
+
+    try {
+      auto t0 = chrono::steady_clock::now();
+      string partial = c->oc.append(ev).dump();
+      chrono::duration<double> t = chrono::steady_clock::now() - t0;
+      ss->reply("PARTIAL " + id + "  " + partial + " " + to_string(t.count()));
+    }
+    catch (std::exception &e) { ss->reply("ERROR " + id + " " + e.what()); }
+  }
+
+  try {
+    auto t0 = chrono::steady_clock::now();
+    bool fitting;
+    string solution = c->oc.close(fitting).dump();
+    chrono::duration<double> t = chrono::steady_clock::now() - t0;
+    ss->reply("RESULT " + id + "  " + solution + " " + fitting_name(fitting) + " " + to_string(t.count()));
+  }
+  catch (std::exception &e) { ss->reply("ERROR " + id + " " + e.what()); }
+}
+
+///////////////////////////////////////////////////////
+/// queue an event (or the end, if ev is NULL) of an open case,
+/// and get a worker to handle it if none is doing it already.
+
+void queue_case(shared_ptr<session> ss, const string &id, shared_ptr<open_case> c, const string *ev) {
+  lock_guard<mutex> lock(c->mtx);
+  if (ev!=NULL) c->events.push_back(*ev);
+  else c->closing = true;
+
+  if (not c->scheduled) {
+    c->scheduled = true;
+    ss->started();
+    pool->submit([ss, id, c](int) { 
+        handle_case(ss, id, c); 
+        ss->finished();
+      });
+  }
+}
+
+///////////////////////////////////////////////////////
+/// serve requests of a session until QUIT or end of input.
+/// Protocol (one request per line, fields separated by whitespace):
+///    LOAD name model-prefix config   -> OK name
+///    UNLOAD name                     -> OK name
+///    MODELS                          -> OK name1 name2 ...
+///    ALIGN name case-id ev1 ev2 ...  -> RESULT case-id alignment fitting time
+///    APPEND name case-id event       -> PARTIAL case-id provisional-alignment time
+///    CLOSE case-id                   -> RESULT case-id alignment fitting time
+///    WAIT                            -> OK   (once all alignments queued by this session are replied)
+///    QUIT
+/// Failed requests are replied with "ERROR message" (errors while aligning
+/// a case are replied as "ERROR case-id message"). ALIGN requests are
+/// solved by the workers, so their replies may come in any order.
+/// APPEND and CLOSE align a case online: replies for the same case 
+/// come in order, each PARTIAL with the alignment of its last events
+/// (earlier ones are already committed).
+
+void serve(shared_ptr<session> ss) {
+
+  char *buff = NULL;
+  size_t len = 0;
+  while (getline(&buff, &len, ss->in) != -1) {
+    istringstream sin(buff);
+    string cmd;
+    sin >> cmd;
+
+    // errors throw (see main): reply them, and go on with next request
+    try {
+      if (cmd.empty() or cmd[0]=='#') continue;
+
+      else if (cmd == "ALIGN") {
+        string name, id, ev;
+        sin >> name >> id;
+        vector<string> trace;
+        while (sin >> ev) trace.push_back(ev);
+
+        shared_ptr<entry> e = find_model(name);
+        if (e==NULL) { ss->reply("ERROR " + id + " unknown model " + name); continue; }
+
+        ss->started();
+        pool->submit([ss, e, id, trace](int w) {
+            if (ss->closed()) { ss->finished(); return; }
+            try {
+              auto t0 = chrono::steady_clock::now();
+              bool fitting;
+              string solution = e->aligners[w]->align(trace, fitting).dump();
+              chrono::duration<double> t = chrono::steady_clock::now() - t0;
+              ss->reply("RESULT " + id + "  " + solution + " " + fitting_name(fitting) + " " + to_string(t.count()));
+            }
+            catch (std::exception &ex) { ss->reply("ERROR " + id + " " + ex.what()); }
+            ss->finished();
+          });
+      }
+
+      else if (cmd == "APPEND") {
+        string name, id, ev;
+        sin >> name >> id >> ev;
+        if (ev.empty()) { ss->reply("ERROR " + id + " usage: APPEND name case-id event"); continue; }
+      
+        auto c = ss->cases.find(id);
+        if (c==ss->cases.end()) {
+          shared_ptr<entry> e = find_model(name);
+          if (e==NULL) { ss->reply("ERROR " + id + " unknown model " + name); continue; }
+          c = ss->cases.insert(make_pair(id, shared_ptr<open_case>(new open_case(e)))).first;
+        }
+        queue_case(ss, id, c->second, &ev);
+      }
+
+      else if (cmd == "CLOSE") {
+        string id;
+        sin >> id;
+
+        auto c = ss->cases.find(id);
+        if (c==ss->cases.end()) { ss->reply("ERROR " + id + " unknown case"); continue; }
+        queue_case(ss, id, c->second, NULL);
+        ss->cases.erase(c);
+      }
+
+      else if (cmd == "LOAD") {
+        string name, basename, fconfig;
+        sin >> name >> basename >> fconfig;
+        if (fconfig.empty()) { ss->reply("ERROR usage: LOAD name model-prefix config"); continue; }
+
+        if (not model::available(basename, fconfig)) { ss->reply("ERROR cannot read model " + basename + " or config " + fconfig); continue; }
+      
+        // loading errors throw (see main), so a malformed model does not bring the server down
+        TRACE(1, "Loading model " << name << " from " << basename);
+        shared_ptr<entry> e;
+        string err;
+        try { 
+          e.reset(new entry(basename, fconfig, pool->size()));
+          err = e->m.check();
+        }
+        catch (std::exception &ex) { err = ex.what(); }
+        if (not err.empty()) { ss->reply("ERROR cannot load model " + basename + ": " + err); continue; }
+
+        {
+          lock_guard<mutex> lock(registry_mtx);
+          registry[name] = e;
+        }
+        ss->reply("OK " + name);
+      }
+
+      else if (cmd == "UNLOAD") {
+        string name;
+        sin >> name;
+        lock_guard<mutex> lock(registry_mtx);
+        if (registry.erase(name)>0) ss->reply("OK " + name);
+        else ss->reply("ERROR unknown model " + name);
+      }
+
+      else if (cmd == "MODELS") {
+        string names = "OK";
+        lock_guard<mutex> lock(registry_mtx);
+        for (auto &r : registry) names += " " + r.first;
+        ss->reply(names);
+      }
+
+      else if (cmd == "WAIT") {
+        ss->wait();
+        ss->reply("OK");
+      }
+
+      else if (cmd == "QUIT") break;
+
+      else ss->reply("ERROR unknown request " + cmd);
+    }
+    catch (std::exception &ex) { ss->reply(string("ERROR ") + ex.what()); }
+
+    if (ss->closed()) break;
+  }
+
+  free(buff);
+}
+
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  int nworkers = 0;
+  string fsocket;
+  string tracing;
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    if (arg=="-w" and i+1<argc) nworkers = atoi(argv[++i]);
+    else if (arg=="-s" and i+1<argc) fsocket = argv[++i];
+    else if (arg[0]!='-' and tracing.empty()) tracing = arg;
+    else {
+      ERROR_CRASH("Usage " << argv[0] << " [-w workers] [-s socket] [tracingoptions]\n         Serves requests on stdin/stdout, or on given Unix domain socket.\n         tracingoptions format is level:hexmask. eg. 4:0x103");
+    }
+  }
+
+  traces::set_tracing(tracing);
+  pool = new worker_pool(nworkers);
+  // a client closing its connection must not end the server: writes to it fail instead
+  signal(SIGPIPE, SIG_IGN);
+
+  if (fsocket.empty()) {
+    // single session on standard input/output. From now on, errors are replied instead of ending the server
+    traces::ThrowErrors = true;
+    serve(shared_ptr<session>(new session(stdin, stdout)));
+    pool->wait();
+  }
+  else {
+    // one session per connection on the socket
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, fsocket.c_str(), sizeof(addr.sun_path)-1);
+    unlink(fsocket.c_str());
+    if (sock<0 or ::bind(sock, (sockaddr*)&addr, sizeof(addr))<0 or listen(sock, 16)<0) {
+      ERROR_CRASH("Error opening socket '" << fsocket << "': " << strerror(errno));
+    }
+
+    TRACE(1, "Listening on " << fsocket);
+    traces::ThrowErrors = true;
+    while (true) {
+      int fd = accept(sock, NULL, NULL);
+      if (fd<0) continue;
+      shared_ptr<session> ss(new session(fdopen(fd,"r"), fdopen(dup(fd),"w")));
+      thread(serve, ss).detach();
+    }
+  }
+
+  delete pool;
+}
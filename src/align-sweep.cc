@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <set>
+#include <cstdio>
+#include <ctime>
+
+#include "aligner.h"
+#include "log.h"
+#include "output.h"
+#include "traces.h"
+#define MOD_TRACENAME "SWEEP"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+// parameters that can be swept: they only change compatibility values, initial
+// weights, or the solver, so the labels of each trace are built only once
+const set<string> SWEEPABLE = {"DummyInitialWeight", "DummyCompatibility", "ExclusiveCompatibility",
+                               "CrossCompatibility", "RepeatCompatibility", "OrderCompatibility",
+                               "ParallelCompatibility", "MaximumDistance",
+                               "RL_MaxIter", "RL_ScaleFactor", "RL_Epsilon", "RL_PruneThreshold"};
+
+///////////////////////////////////////////////////////
+/// A configuration of the sweep, with its solver and results
+
+class setting {
+ public:
+  string name;
+  config cfg;
+  relax solver;
+  /// cost (log and visible model moves) and fitting cases, CPU time and RL iterations
+  long cost, fitting;
+  double time;
+  long iterations;
+  /// alignments output, if requested
+  FILE *out;
+  unique_ptr<result_writer> writer;
+
+  setting(const string &n, const config &c) : name(n), cfg(c), 
+    solver(c.MAX_ITER, c.SCALE_FACTOR, c.EPSILON, c.PRUNE_THRESHOLD),
+    cost(0), fitting(0), time(0), iterations(0), out(NULL) {}
+};
+
+///////////////////////////////////////////////////////
+/// cost of an alignment: its log moves and model moves on visible tasks
+/// (same as bin/eval-relax.sh counts)
+
+int alignment_cost(const alignment &seq) {
+  int cost = 0;
+  for (auto &e : seq) {
+    if (e.type==align_elem::LOG) ++cost;
+    else if (e.type==align_elem::MODEL and seq.name(e).compare(0, 3, "tau")!=0) ++cost;
+  }
+  return cost;
+}
+
+///////////////////////////////////////////////////////
+/// configuration line setting a swept value. A compatibility value with
+/// no type ("1/dist", or e.g. "const" for a constant one) keeps the type
+/// of the base configuration
+
+string config_line(const string &key, const string &value, const config &base) {
+  string line = key + " " + value;
+  bool typed = (value.find(' ')!=string::npos);
+  if (not typed and ((key=="OrderCompatibility" and base.ORDER_PROGRESSIVE) or 
+                     (key=="ParallelCompatibility" and base.PARALLEL_PROGRESSIVE)))
+    line += " 1/dist";
+  return line;
+}
+
+///////////////////////////////////////////////////////
+/// expand the grid "Key=v1,v2,.." arguments into all their combinations,
+/// each applied on top of the base configuration
+
+void expand_grid(const vector<pair<string,vector<string>>> &grid, size_t k, const config &cfg, 
+                 const string &name, vector<unique_ptr<setting>> &settings) {
+  if (k==grid.size()) {
+    settings.push_back(unique_ptr<setting>(new setting(name.empty() ? "base" : name, cfg)));
+    return;
+  }
+  for (auto &v : grid[k].second) {
+    config c = cfg;
+    c.set(config_line(grid[k].first, v, cfg));
+    expand_grid(grid, k+1, c, name + (name.empty() ? "" : ";") + grid[k].first + "=" + v, settings);
+  }
+}
+
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  vector<string> args;
+  vector<pair<string,vector<string>>> grid;
+  string outprefix;
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    size_t eq = arg.find('=');
+    if (arg=="-o" and i+1<argc) outprefix = argv[++i];
+    else if (eq!=string::npos) {
+      string key = arg.substr(0,eq);
+      if (SWEEPABLE.count(key)==0) ERROR_CRASH("Parameter " << key << " can not be swept");
+      vector<string> values;
+      istringstream sin(arg.substr(eq+1));
+      string v;
+      while (getline(sin, v, ',')) values.push_back(v);
+      grid.push_back(make_pair(key, values));
+    }
+    else args.push_back(arg);
+  }
+
+  if (args.size()<3) {
+    ERROR_CRASH("Usage " << argv[0] << " [-o outprefix] model-prefix traces config Key=value1,value2,.. [Key=..] [tracingoptions]\n         Aligns the log with all combinations of given configuration values, loading model and log once.\n         Writes alignments of the n-th combination to outprefix.n.out if -o is given.\n         tracingoptions format is level:hexmask. eg. 4:0x103\n         e.g.: "<<argv[0] << " modelsdir/M1 logsdir/M1.xes configdir/cfile.cfg OrderCompatibility=2,5,10 ExclusiveCompatibility=-20,-50");
+  }
+
+  string basename(args[0]);
+  string ftrace(args[1]);
+  string fconfig(args[2]);
+  traces::set_tracing(args.size()>3 ? args[3] : "");
+
+  TRACE(1, "Loading model..."<<basename);
+  model m(basename, fconfig);
+  TRACE(1, "Loading trace file " << ftrace);
+  trace_log log;
+  log.load(ftrace, m.cfg.LOAD_THREADS);
+  TRACE(1, "Loaded " << log.num_cases() << " traces, " << log.num_variants() << " variants...");
+
+  if (m.cfg.WINDOW_SIZE>0 or m.cfg.BATCH_SIZE>1 or m.cfg.WARM_START) 
+    WARNING("WARNING: WindowSize, BatchSize and WarmStart are ignored by " << argv[0] << ", each trace is solved as one problem");
+
+  vector<unique_ptr<setting>> settings;
+  expand_grid(grid, 0, m.cfg, "", settings);
+
+  // the label structure must cover the largest distance used, and keep
+  // distance balances if some setting has progressive compatibilities,
+  // and dummy triples if some setting uses them
+  int max_dist = 1;
+  bool balances = false, dummies = false;
+  for (auto &s : settings) {
+    if (max_dist!=0) max_dist = (s->cfg.MAX_DIST==0 ? 0 : std::max(max_dist, s->cfg.MAX_DIST));
+    balances = balances or s->cfg.ORDER_PROGRESSIVE or s->cfg.PARALLEL_PROGRESSIVE;
+    dummies = dummies or s->cfg.DUMMY_COMPAT!=0;
+  }
+
+  for (size_t k=0; k<settings.size(); ++k) {
+    setting &s = *settings[k];
+    cerr << "Setting " << k << ": " << s.name << endl;
+    if (not outprefix.empty()) {
+      string fout = outprefix + "." + to_string(k) + ".out";
+      s.out = fopen(fout.c_str(), "w");
+      if (s.out==NULL) ERROR_CRASH("Error opening output file " << fout);
+      s.writer.reset(new result_writer(s.out, result_writer::format(s.cfg.OUTPUT_FORMAT), m.g, log));
+    }
+  }
+
+  problem prob;
+  double build_time = 0;
+  int replayed = 0;
+
+  for (uint32_t v : log.by_name()) {
+    vector<string> trace = log.get_variant(v);
+    vector<string> cases = log.get_cases(v);
+    TRACE(0, "ALIGNING TRACE " << cases[0] << " (and synonyms)");
+
+    // traces fitting by replay have the same alignment with all settings
+    clock_t t0 = clock();
+    alignment seq;
+    if (m.cfg.FAST_REPLAY and replay_alignment(trace, m, seq)) {
+      TRACE(1, "  Trace fits by replay, no RL needed");
+      double t = double(clock()-t0)/double(CLOCKS_PER_SEC);
+      string solution = seq.dump();
+      for (auto &s : settings) {
+        s->fitting += cases.size();
+        s->time += t;
+        if (s->writer!=NULL) s->writer->write(solution, fitting_name(true), t, cases, &seq);
+      }
+      ++replayed;
+      continue;
+    }
+
+    TRACE(1, "  Building label structure size="<<trace.size());
+    labeling_structure st(trace, m, max_dist, balances, dummies);
+    build_time += double(clock()-t0)/double(CLOCKS_PER_SEC);
+
+    for (auto &s : settings) {
+      clock_t t1 = clock();
+      st.build_problem(prob, s->cfg);
+      s->iterations += s->solver.solve(prob);
+      bool fits;
+      alignment seq = complete_alignment(trace, best_labels(prob, trace.size()), m, fits);
+      double t = double(clock()-t1)/double(CLOCKS_PER_SEC);
+
+      s->cost += alignment_cost(seq) * long(cases.size());
+      if (fits) s->fitting += cases.size();
+      s->time += t;
+      if (s->writer!=NULL) s->writer->write(seq.dump(), fitting_name(fits), t, cases, &seq);
+    }
+  }
+
+  cerr << log.num_variants() << " variants, " << replayed << " fitting by replay. Label structures built in " 
+       << build_time << "s, shared by " << settings.size() << " settings" << endl;
+
+  cout << "# setting av.cost cost cases fitting time(s) RL-iterations parameters" << endl;
+  for (size_t k=0; k<settings.size(); ++k) {
+    setting &s = *settings[k];
+    cout << k << " " << double(s.cost)/log.num_cases() << " " << s.cost << " " << log.num_cases() << " " 
+         << s.fitting << " " << s.time << " " << s.iterations << " " << s.name << endl;
+    if (s.writer!=NULL) {
+      s.writer.reset();
+      fclose(s.out);
+    }
+  }
+}
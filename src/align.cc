@@ -30,6 +30,7 @@
 #include <climits>
 #include <algorithm>
 #include <vector>
+#include <chrono>
 
 #include "util.h"
 #include "graph.h"
@@ -37,321 +38,39 @@
 #include "bp.h"
 #include "config.h"
 #include "alignment.h"
+#include "aligner.h"
+#include "warmstart.h"
+#include "cache.h"
+#include "log.h"
+#include "output.h"
+#include "perfcount.h"
+#include "timeline.h"
+#include "allocount.h"
 #include "traces.h"
 #define MOD_TRACENAME "ALIGN"
 #define MOD_TRACECODE MAIN_TRACE
 
 using namespace std;
 
-// configuration
-config *cfg;
-
-
-///////////////////////////////////////////////////////
-/// add labels (possible alignments) to variables (trace events)
-/// in a RL constraint satisfaction problem
-
-void add_variable_labels(problem & prob,
-                         const vector<string> &trace,
-                         const graph& g) {
-
-  // add possible alignments for each event
-  for (size_t nv=0; nv<trace.size(); ++nv) {
-    TRACE(2, "Adding variable " << nv << " " << trace[nv]);
-    prob.set_var_name(nv, trace[nv]);
-    // get candidates to be aligned
-    list<string> labels = g.get_nodes_by_name(trace[nv]);
-    // add them as labels for variable nv
-    int nl=0;
-    for (auto id : labels) {
-      TRACE(2, "     label " << nl << " " << id);
-      prob.add_label(nv, (1.0-cfg->DUMMY_INITIAL_WEIGHT)/labels.size(), id);
-      ++nl;
-    }
-    // add an extra dummy label
-    prob.add_label(nv, cfg->DUMMY_INITIAL_WEIGHT, graph::DUMMY);
-  }
-}
-
-///////////////////////////////////////////////////////
-/// compute difference between events ev1,ev2 position
-//  in the trace to the distance in tho model between candidate
-//  tasks lb1,lb2.
-
-double distance_balance(int ev1, int lb1, int ev2, int lb2, const graph& g, const problem& prob, bool progressive) {
-
-  if (not progressive) return 1.0;
-
-  string lname1 = prob.get_label_name(ev1,lb1);
-  string lname2 = prob.get_label_name(ev2,lb2);                       
-
-  double dg = g.distance(lname1, lname2); 
-   
-  double dt = abs(ev1-ev2);  // distance in the trace
-
-  TRACE(4, "  distance_balance "<<lname1<<" "<<lname2<<" dg="<<dg<<" dt="<<dt);
-
-  return abs(dt-dg) + 1;  // add one to avoid zeros.
-}
-
-///////////////////////////////////////////////////////
-/// add constraints (BP restrictions) between
-/// labels (possible alignments)
-
-void add_constraints(problem & prob,
-                     const vector<string> &trace,
-                     const behavioral_profile &bp,
-                     const behavioral_profile &bptf,
-                     const graph &g) {
-
-  // longest ngram to consider (all the length if MAX_DIST==0)
-  int md = (cfg->MAX_DIST!=0 ? cfg->MAX_DIST : 2*g.get_num_nodes()); 
-
-  int M = trace.size();
-  for (int ev1=0; ev1<M; ++ev1) {
-    for (int ev2=ev1+1; ev2<=std::min(M-1, ev1+md); ++ev2) {
-      for (int lb1=0; lb1<prob.get_num_labels(ev1); ++lb1) {
-        for (int lb2=0; lb2<prob.get_num_labels(ev2); ++lb2) {
-
-          string t1 = prob.get_label_name(ev1,lb1);
-          string t2 = prob.get_label_name(ev2,lb2);
-          
-          if (t1 == graph::DUMMY or t2 == graph::DUMMY)
-            continue;
-          
-          else if (cfg->REPEAT_COMPAT!=0 and
-                   prob.get_label_name(ev1,lb1) == prob.get_label_name(ev2,lb2)) {
-            TRACE(4, "Repeat compatibility constraint");
-            prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->REPEAT_COMPAT);            
-            prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->REPEAT_COMPAT);
-          }
-          
-          else {
-            switch (bp.get_relation(t1,t2)) {
-              case behavioral_profile::NO_RELATION : {
-                 ERROR_CRASH("Invalid or missing BP relation for pair "
-                             << prob.get_label_name(ev1,lb1) << " "
-                             << prob.get_label_name(ev2,lb2) );                 
-              }
-                
-              case behavioral_profile::PRECEDES :
-                if (cfg->ORDER_COMPAT!=0) {
-                  double diff;
-                  diff = distance_balance(ev1, lb1, ev2, lb2, g, prob, cfg->ORDER_PROGRESSIVE);
-                  
-                  TRACE(4, "Order compatibility constraint. diff="<<diff);
-                  prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->ORDER_COMPAT/diff);
-                  prob.add_constraint(ev2, lb2, {{make_pair(ev1,lb1)}}, cfg->ORDER_COMPAT/diff);
-                }
-                break;
-              
-              case behavioral_profile::FOLLOWS :
-                if (cfg->CROSS_COMPAT!=0) {
-                  TRACE(4, "Cross compatibility constraint");
-                  prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->CROSS_COMPAT);
-                  prob.add_constraint(ev2, lb2, {{make_pair(ev1,lb1)}}, cfg->CROSS_COMPAT);
-                }
-                break;
-              
-              case behavioral_profile::EXCLUSIVE :
-                if (cfg->EXCLUSIVE_COMPAT!=0) {
-                  TRACE(4, "Exclusive compatibility constraint");
-                  prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->EXCLUSIVE_COMPAT);
-                  prob.add_constraint(ev2, lb2, {{make_pair(ev1,lb1)}}, cfg->EXCLUSIVE_COMPAT);
-                }
-                break;
-              
-              case behavioral_profile::INTERLEAVED :
-                if (cfg->PARALLEL_COMPAT!=0) {
-                  TRACE(4, "Parallel compatibility constraint");
-                  double diff;
-                  // "real" paralels get no penalty for long paths
-                  if (bptf.get_relation(t1,t2)==behavioral_profile::INTERLEAVED) diff = 1;
-                  else diff = distance_balance(ev1, lb1, ev2, lb2, g, prob, cfg->PARALLEL_PROGRESSIVE);
-                  prob.add_constraint(ev1, lb1, {{make_pair(ev2,lb2)}}, cfg->PARALLEL_COMPAT/diff);
-
-                  if (bptf.get_relation(t2,t1)==behavioral_profile::INTERLEAVED) diff = 1;
-                  else diff = distance_balance(ev2, lb2, ev1, lb1, g, prob, cfg->PARALLEL_PROGRESSIVE);
-                  prob.add_constraint(ev2, lb2, {{make_pair(ev1,lb1)}}, cfg->PARALLEL_COMPAT/diff);
-                }
-                break;
-            }
-          }
-        }
-      }
-    }
-  }
-
-  if (cfg->DUMMY_COMPAT!=0) {
-    // add constraints favoring dummy label ([L])
-    // Given events A X B, if aligning X would create a path between A and B longer than
-    // the A-B path if X is ommited, penalize the alignment of X
-    for (int ev=1; ev<M-1; ++ev) {      
-      int evL = ev-1;
-      int evR = ev+1;
-      for (int lb=0; lb<prob.get_num_labels(ev)-1; ++lb) {  // all labels except DUMMY
-        string te = prob.get_label_name(ev,lb);
-        for (int lbL=0; lbL<prob.get_num_labels(evL)-1; ++lbL) { // all labels except DUMMY
-          for (int lbR=0; lbR<prob.get_num_labels(evR)-1; ++lbR) { // all labels except DUMMY
-            string tL = prob.get_label_name(evL,lbL);
-            string tR = prob.get_label_name(evR,lbR);
-
-            double dLR = -1;
-            if (bptf.get_relation(tL,tR)==behavioral_profile::INTERLEAVED) dLR = 0;
-            else if (g.path_exists(tL,tR)) dLR = g.distance(tL,tR);
-            //else dLR = g.get_num_nodes()*2;
-
-            double dLe = -1;
-            if (bptf.get_relation(tL,te)==behavioral_profile::INTERLEAVED) dLe = 0;
-            else if (g.path_exists(tL,te)) dLe = g.distance(tL,te);
-            //else dLe = g.get_num_nodes()*2;
-
-            double deR = -1;
-            if (bptf.get_relation(te,tR)==behavioral_profile::INTERLEAVED) deR = 0;
-            else if (g.path_exists(te,tR)) deR = g.distance(te,tR);
-            //else deR = g.get_num_nodes()*2;
-            
-            TRACE(5, "checking Dummy compatibility constraint "<<tL<<"-["<<te<<"]-"<<tR<<" "<<dLR<<" "<<dLe<<" "<<deR );
-            if (dLR>=0 and dLe>=0 and deR>=0 and dLR < dLe+deR-1) {
-              TRACE(4, "Dummy compatibility constraint");
-              prob.add_constraint(ev, lb, {{make_pair(evL,lbL)},{make_pair(evR,lbR)}}, cfg->DUMMY_COMPAT*(dLe+deR-1-dLR) );
-            }
-          }
-        }
-      }
-    }
-  }
-
-}
-
-///////////////////////////////////////////////////////
-/// create a constraint satisfaction problem,
-/// add fill it using event, alignment, and BP information
-
-problem create_labeling_problem(const vector<string> &trace,
-                                const graph& g,
-                                const behavioral_profile &bp,
-                                const behavioral_profile &bptf) {
-
-  // each trace event is a variable in our alignment problem
-  problem prob(trace.size());
-  // add possible alignments for each event (i.e. possible labels for each variable)
-  TRACE(1, "Adding variables ");
-  add_variable_labels(prob,trace,g);
-  // create constraints according to BP
-  TRACE(1, "Adding constraints ");
-  add_constraints(prob,trace,bp,bptf,g); 
-      
-  return prob;
-}
-
-
-
 ///////////////////////////////////////////////////////
-/// load traces from a .xes file
+/// load traces from a .xes file (or a binary log created with
+/// compile-log), warning about events with no matching task in the model
 
-map<vector<string>,vector<string>> load_traces(const string &fname, const graph &g) {
-    // open input file
-    pugi::xml_document xmldoc;
-    xmldoc.load_file(fname.c_str(), pugi::parse_default|pugi::parse_ws_pcdata);
-    TRACE(1, "loaded trace file");
+void load_traces(const string &fname, const graph &g, trace_log &log, int threads) {
 
-    map<vector<string>,vector<string>> result;
+    log.load(fname, threads);
 
-    // get each "trace" node under "log"
-    pugi::xml_node trace = xmldoc.child("log").child("trace");
-    
-    map<string,int> warned;
-    while (trace) {
-      string trace_id = trace.find_child_by_attribute("string","key","concept:name").attribute("value").value();
-      std::replace(trace_id.begin(),trace_id.end(),' ','_');
-      TRACE(7, "found new trace id="<<trace_id);
-      // get each event of the trace
-      vector<string> evs;
-      pugi::xml_node event = trace.child("event");
-      while (event) {
-        pugi::xml_node name = event.find_child_by_attribute("string","key","concept:name");
-        string evname = name.attribute("value").value();
-        std::replace(evname.begin(),evname.end(),' ','_');
-        evs.push_back(evname);
-        TRACE(7, "   read event "<<evname);
-        if (g.get_nodes_by_name(evname).empty()) {
-          if (warned.find(evname)==warned.end()) warned.insert(make_pair(evname,1));          
-          else warned[evname] += 1;
-        }
-        event = event.next_sibling("event");
-      }
-
-      auto t = result.find(evs);
-      if (t==result.end()) { // new trace, add to map
-        vector<string> id = {trace_id};
-        result.insert(make_pair(evs,id));
-      }
-      else // already seen trace, add id to list of synonyms
-        t->second.push_back(trace_id);
-
-      trace = trace.next_sibling("trace");
-    }
+    // unknown events, sorted by name
+    map<string,uint64_t> warned;
+    for (uint32_t a=0; a<log.num_activities(); ++a) 
+      if (g.get_nodes_by_name(log.get_activity(a)).empty()) 
+        warned.insert(make_pair(log.get_activity(a), log.get_activity_count(a)));
 
     for (auto w : warned) {
       WARNING("WARNING: Event name '"<<w.first<<"' occurred "<<w.second<<" times in the log, but no matching model task was found.");
     }
-    
-    return result;   
-}
-
-
-///////////////////////////////////////////////////////
-/// create an alignment from a solved RL problem
-
-alignment RL_to_alignment(const graph& g, const vector<string> &trace, const problem& prob) {
-  
-  alignment seq;
-  for (auto n : g.get_initial_nodes())
-    seq.push_back(align_elem(n,"^","[ANCHOR]")); // initial place, to anchor the sequence
-  
-  for (size_t nv=0; nv<trace.size(); ++nv) {
-    int best = prob.best_label(nv).front();
-    string var1 = prob.get_var_name(nv);
-    string lab1 = prob.get_label_name(nv,best);
-    
-    if (lab1 == graph::DUMMY) seq.push_back(align_elem(lab1,var1,"[L]"));
-    else seq.push_back(align_elem(lab1,var1,"[L/M]"));
-  }
-  
-  for (auto n : g.get_final_nodes())
-    seq.push_back(align_elem(n,"^","[ANCHOR]")); // final place, to anchor the sequence
-  
-  return seq;
 }
 
-  
-///////////////////////////////////////////////////////
-/// add missing model moves to an alignment
-
-void add_model_moves(alignment &seq, const graph &g, const behavioral_profile &bptf) {
-  alignment::iterator p = seq.begin();
-  alignment::iterator pprev = p; 
-  ++p;  // start at second element (first is the anchor, initial place)
-  while (p!=seq.end()) {
-    
-    if (p->type != "[L]") {   // skip deletions
-      
-      if (g.path_exists(pprev->id,p->id) and bptf.get_relation(pprev->id,p->id)!=behavioral_profile::INTERLEAVED) {
-        list<string> mreal = g.path(pprev->id,p->id);
-        for (auto m : mreal) {
-          if (g.get_node(m).type == node::TRANSITION)
-            seq.insert(p, align_elem(m, g.get_node(m).name, "[M-REAL]"));
-        }
-      }
-      
-      pprev = p; // 'pprev' remembers is the last non-deletion element seen
-    }
-    
-    ++p;
-  }
-  
-}
 
 /// ===========================
 /// ========= MAIN ============
@@ -367,214 +86,335 @@ int main(int argc, char *argv[]) {
   string basename(argv[1]);
   string ftrace(argv[2]);
   string fconfig(argv[3]);
-  cfg = new config(fconfig);
 
   traces::set_tracing(argc>4 ? string(argv[4]) : "");
   
-  string modelfile = basename+".bp.pnml";
-  TRACE(1, "Loading graph..."<<modelfile); // load XML model file
-  graph g(modelfile, graph::UNFOLDING, cfg->ADD_IFS, cfg->ADD_LOOPS); 
-  g.add_node(node(node::TRANSITION, graph::DUMMY, graph::DUMMY));  // add "dummy" node
-
-  string fpaths = basename+".tt.path";
-  TRACE(1, "Loading paths..."<<fpaths);
-  g.load_paths(fpaths);
-
-  // bptf is BP without loops (used to detect "real" parallels)
-  string fbp = basename+".tf.bp";
-  TRACE(1, "Loading BPs..."<<fbp);
-  behavioral_profile bptf(fbp);
-  TRACE(7, "BP loaded is: " << bptf.dump(true) );
-
-  // bp is BP defined by config file (tf: w/o loops, tt: w/ loops)
-  fbp = basename+".tt.bp";
-  TRACE(1, "Loading BPs..."<<fbp);
-  behavioral_profile bp(fbp);
-  TRACE(7, "BP loaded is: " << bp.dump(true));
+  // wall time of each phase, for statistics
+  auto t_start = chrono::steady_clock::now();
+
+  // configuration goes first, in case the timeline of the whole run is recorded
+  config c(fconfig);
+  if (not c.TIMELINE.empty()) timeline::start();
+
+  TRACE(1, "Loading model..."<<basename); // load model files
+  model m(basename, c);
+  auto t_model = chrono::steady_clock::now();
+  const config *cfg = &m.cfg;
+  const graph &g = m.g;
 
   TRACE(1, "Loading trace file " << ftrace);
-  map<vector<string>,vector<string>> log = load_traces(ftrace,g);  // load traces
-  TRACE(1, "Loaded " << log.size() << " traces...");
+  trace_log log;
+  load_traces(ftrace, g, log, cfg->LOAD_THREADS);  // load traces
+  TRACE(1, "Loaded " << log.num_cases() << " traces, " << log.num_variants() << " variants...");
+  auto t_log = chrono::steady_clock::now();
+  long log_allocs = allocation_count();
 
   /// Create a RL solver for the constraint satisfaction problems
-  relax solver(cfg->MAX_ITER, cfg->SCALE_FACTOR, cfg->EPSILON);
-
-  for (auto trace : log) {
-    // try to align trace and graph.
-    TRACE(1, "-----------------------------------------------------");
-    TRACE(0, "ALIGNING TRACE " << trace.second[0] << " (and synonyms)");
+  relax solver(cfg->MAX_ITER, cfg->SCALE_FACTOR, cfg->EPSILON, cfg->PRUNE_THRESHOLD);
+
+  /// converged weights of solved traces, to warm start those sharing a prefix
+  warm_start_cache wcache;
+  long rl_iters=0, cold_iters=0;
+  int warm_seeded=0, warm_differ=0;
+
+  /// problem objects, reused for all variants to avoid reallocating their tables
+  vector<problem> pool(std::max(cfg->BATCH_SIZE,1));
+  problem scratch;
+  problem_batch batch;
+  /// labels and constrained pairs of the problems in the pool
+  vector<labeling_structure> structs;
+  structs.reserve(pool.size());
+
+  /// variants aligned by token replay, and time spent on them and on RL ones
+  int fast_count=0, rl_count=0;
+  double fast_time=0, rl_time=0;
+
+  /// alignments of previous runs with the same model files and parameters
+  result_cache *rcache = NULL;
+  int cache_hits=0;
+  if (not cfg->RESULT_CACHE.empty()) {
+    uint64_t ctx = result_cache::hash(cfg->signature());
+    for (string ext : {".bp.pnml", ".tt.path", ".tf.bp", ".tt.bp"})
+      ctx = result_cache::hash_file(basename+ext, ctx);
+    rcache = new result_cache(cfg->RESULT_CACHE, ctx);
+  }
 
-    clock_t t0 = clock();  // initial time
+  /// buffered writer for the results
+  result_writer writer(stdout, result_writer::format(cfg->OUTPUT_FORMAT), g, log);
+
+  /// gap-filling states of variant prefixes, shared by variants with the same prefix and labels
+  prefix_cache *pcache = NULL;
+  if (cfg->PREFIX_CACHE>0) pcache = new prefix_cache(m);
+
+  /// hardware counters of the build, solve and gap fill phases, and work done in them
+  perf_counters *perf = NULL;
+  perf_counters::sample perf_build, perf_solve, perf_fill;
+  long perf_constraints=0, perf_events=0;
+  if (cfg->PERF_COUNTERS) {
+    perf = new perf_counters();
+    if (not perf->any_available()) 
+      WARNING("WARNING: Hardware performance counters not available, only CPU time of each phase will be reported.");
+  }
 
-    // create constraint satisfaction problem 
-    TRACE(1, "  Creating RL problem size="<<trace.first.size());
-    problem prob = create_labeling_problem(trace.first, g, bp, bptf);
+  // variants are aligned in the order of their event names
+  vector<uint32_t> variants = log.by_name();
+  auto next = variants.begin();
+  while (next != variants.end()) {
 
-    // solve constraint satisfaction problem using RL
-    TRACE(1, "  solving RL problem");
-    solver.solve(prob);
+    // take next group of variants to be solved together (just one if batching is off)
+    vector<uint32_t> group;
+    while (next!=variants.end() and int(group.size())<std::max(cfg->BATCH_SIZE,1)) {
+      group.push_back(*next);
+      ++next;
+    }
 
-    TRACE(1, "  solved. Adding model moves");
-    
-    // extract solution and create a (partially) aligned sequence
-    alignment seq = RL_to_alignment(g, trace.first, prob);
-    TRACE(3, "initial alignment: "<< seq.dump());
-    TRACE(3, "initial alignment: "<< seq.dump(true));
-
-    /*  --------------- BEGIN OF NEW COMPLETION PROPOSAL -------------*/
-    set<string> open = g.get_initial_nodes();
-    auto p = seq.begin();
-    ++p; // skip anchor
-    while (p != seq.end()) {
-      if (p->type=="[L]") {
-        ++p;
+    // events of each variant of the group
+    vector<vector<string>> traces(group.size());
+    for (size_t i=0; i<group.size(); ++i) traces[i] = log.get_variant(group[i]);
+
+    // CPU time spent on each variant of the group
+    vector<double> time(group.size(), 0.0);
+    // best labels for each variant, once solved
+    vector<vector<string>> labels(group.size());
+    // alignment for variants solved without RL (cached, or fitting the model by plain replay)
+    vector<string> known(group.size()), known_fitting(group.size());
+    vector<bool> cached(group.size(), false);
+    // alignments computed now (not from the result cache), written with their moves
+    vector<alignment> moves(group.size());
+    // hardware counters of each phase for each variant
+    vector<perf_counters::sample> pbuild(group.size()), psolve(group.size()), pfill(group.size());
+
+    // create constraint satisfaction problems for short traces. Only labels
+    // are added now, constraints are added once we know whether they are batched
+    int nprobs = 0;
+    structs.clear();
+    vector<problem*> prob(group.size(), NULL);
+    for (size_t i=0; i<group.size(); ++i) {
+      const vector<string> &trace = traces[i];
+
+      clock_t t0 = clock();  // initial time
+      if (rcache!=NULL and rcache->lookup(trace, known[i], known_fitting[i])) {
+        TRACE(1, "  Alignment found in result cache");
+        cached[i] = true;
+        time[i] += double(clock()-t0)/double(CLOCKS_PER_SEC);
         continue;
       }
-
-      // p->type is [L/M]. Find a path to p current PN state (maybe empty if p can already be fired)
-      list<string> mreal;
-      if (g.find_path(open, p->id, mreal)) {
-        // there is a path that can fill the gap:  Fill the gap with the shortest path
-        mreal.pop_back(); // Last element is p->id, remove it
-        for (auto m : mreal) {
-          if (g.get_node(m).type == node::TRANSITION) {
-            seq.insert(p, align_elem(m, g.get_node(m).name, "[M-REAL]"));
-            open = g.fire_transition(open, m);
-          }
-        }
-        // we are good up to p, move to next event
-        open = g.fire_transition(open, p->id);
-        ++p;
+      if (cfg->FAST_REPLAY and replay_alignment(trace, m, moves[i])) {
+        TRACE(1, "  Trace fits by replay, no RL needed");
+        known[i] = moves[i].dump();
+        known_fitting[i] = fitting_name(true);
+        time[i] += double(clock()-t0)/double(CLOCKS_PER_SEC);
         continue;
       }
 
-      // p->type is [L/M], and there is no possible set of model moves that will fix this.
-      // Try removing p, to find a path to element after p
-      if (p->type == "[L/M]") {
-        TRACE(3,"No path found to fill the gap. Removing next event "<<p->name<<" ("<<p->id<<")");
-        p->type = "[L]";
-        ++p;
+      if (cfg->WINDOW_SIZE>0 and int(trace.size())>cfg->WINDOW_SIZE) continue;
+      
+      TRACE(1, "  Creating RL problem size="<<trace.size());
+      perf_counters::sample p0;
+      if (perf!=NULL) p0 = perf->read();
+      prob[i] = &pool[nprobs++];
+      structs.emplace_back(trace, m);
+      structs.back().build_labels(*prob[i], *cfg);
+
+      // seed it with weights from already solved traces sharing a prefix
+      if (cfg->WARM_START) {
+        if (wcache.seed(*prob[i], log.get_path(group[i]), cfg->WARM_START_BLEND) > 0) ++warm_seeded;
       }
-      else if (p->type == "[ANCHOR]") {
-        TRACE(3,"No path found to final state "<<p->id<<". Removing anchor.");
-        p = seq.erase(p);
+      if (perf!=NULL) pbuild[i] = perf->read()-p0;
+      time[i] += double(clock()-t0)/double(CLOCKS_PER_SEC);
+    }
+
+    // add constraints, straight into the batch tables if the problems are solved together
+    if (nprobs>1) batch.clear();
+    for (size_t i=0, k=0; i<group.size(); ++i) {
+      if (prob[i]==NULL) continue;
+      clock_t t0 = clock();
+      perf_counters::sample p0;
+      if (perf!=NULL) p0 = perf->read();
+      if (nprobs>1) {
+        batch.add_labels(*prob[i]);
+        structs[k].build_constraints(batch, *cfg);
       }
-      else {
-        // should not happen
-        ERROR_CRASH("Unexpected element "<<p->dump(true)<<" in gap filling process");
+      else structs[k].build_constraints(*prob[i], *cfg);
+      if (perf!=NULL) {
+        pbuild[i] += perf->read()-p0;
+        perf_constraints += (nprobs>1 ? batch.get_num_constraints(k) : prob[i]->get_num_constraints());
       }
-
+      time[i] += double(clock()-t0)/double(CLOCKS_PER_SEC);
+      ++k;
     }
 
+    // solve constraint satisfaction problems using RL
+    if (nprobs>1) {
+      TRACE(1, "  solving batch of "<<nprobs<<" RL problems");
+      clock_t t0 = clock();
+      perf_counters::sample p0;
+      if (perf!=NULL) p0 = perf->read();
+      solver.solve(batch);
+      batch.unpack();
+      for (int k=0; k<batch.size(); ++k) rl_iters += batch.get_iterations(k);
+
+      // share solving time among batched variants
+      double share = double(clock()-t0)/double(CLOCKS_PER_SEC)/nprobs;
+      for (size_t i=0; i<group.size(); ++i) 
+        if (prob[i]!=NULL) time[i] += share;
+      if (perf!=NULL) {
+        perf_counters::sample pshare = (perf->read()-p0)/nprobs;
+        for (size_t i=0; i<group.size(); ++i) 
+          if (prob[i]!=NULL) psolve[i] = pshare;
+      }
+    }
+    else if (nprobs==1) {
+      clock_t t0 = clock();
+      perf_counters::sample p0;
+      if (perf!=NULL) p0 = perf->read();
+      TRACE(1, "  solving RL problem");
+      rl_iters += solver.solve(pool[0]);
+      for (size_t i=0; i<group.size(); ++i) 
+        if (prob[i]!=NULL) {
+          time[i] += double(clock()-t0)/double(CLOCKS_PER_SEC);
+          if (perf!=NULL) psolve[i] = perf->read()-p0;
+        }
+    }
     
-    /*  --------------- END OF NEW COMPLETION PROPOSAL -------------*/
-
-    /*  --------------- BEGIN OF OLD COMPLETION PROPOSAL -------------    
-    // complete sequence with missing model moves
-    add_model_moves(seq, g, bptf);    
-    TRACE(1, "Completed alignment ");
-    TRACE(3, "Completed alignment: "<< seq.dump());
-    TRACE(3, "Completed alignment: "<< seq.dump(true));
-
-    p = seq.begin(); ++p;
-    while (p!=seq.end()) {
-
-      // skip deletions, and look for a parallel split
-      if (p->type=="[L]" or not g.is_parallel_split(p->id)) {
-        ++p;
-        continue;
+    for (size_t i=0; i<group.size(); ++i) {
+      const vector<string> &trace = traces[i];
+      // try to align trace and graph.
+      TRACE(1, "-----------------------------------------------------");
+      vector<string> cases = log.get_cases(group[i]);
+      TRACE(0, "ALIGNING TRACE " << cases[0] << " (and synonyms)");
+
+      clock_t t0 = clock();  // initial time
+
+      string fitting;
+      string solution;
+      if (not known[i].empty()) {
+        solution = known[i];
+        fitting = known_fitting[i];
       }
-
-      TRACE(3, "found split "<<p->id);
-      
-      // it is a parallel split, find its closing join
-      string match = g.find_matching_join(p->id);
-      TRACE(3, "parallel join "<<match<<" found to match split "<<p->id);
-      
-      // locate closing join in the trace, ahead of p
-      alignment::iterator q(p);  
-      while (q!=seq.end() and (q->type=="[L]" or q->id!=match) ) ++q;
-      if (q==seq.end()) {
-        TRACE(1, "No matching parallel join for "<< p->id <<" was found in the trace. Likely non-fitting trace");
-        break;
+      else if (prob[i]==NULL) {
+        // trace too long to be solved at once, use sliding windows
+        TRACE(1, "  Solving RL problem size="<<trace.size()<<" by windows");
+        perf_counters::sample p0;
+        if (perf!=NULL) p0 = perf->read();
+        // window problems are built as they are solved, so building is counted
+        // in the solve phase, with the constraints of all windows
+        labels[i] = solve_windowed(trace, m, solver, scratch, rl_iters, perf!=NULL ? &perf_constraints : NULL);
+        if (perf!=NULL) psolve[i] = perf->read()-p0;
       }
-      
-      set<string> open = g.get_in_edges(p->id);
-      set<string> final = g.get_out_edges(q->id);
-      alignment::iterator pos;
-      while (not g.is_fitting(open, final, p, q, pos, false)) {
-        TRACE(3, "parallel section not fitting! "<<p->id<<" "<<match);
-        
-        // see which states remained opened and shouldn't.
-        set<string> remaining = difference_set(open,final);
-        
-        TRACE(3, " nonfinal remaining opened =["<<set2string(remaining)<<"]   pos="<<pos->id);
-
-        // shortest non-empty path from opened nonfinal to pos.
-        string missing;
-        size_t min=9999999;
-        for (auto r : remaining) {
-          if (g.path_exists(r,pos->id)) {
-            list<string> p = g.path(r,pos->id);
-            if (p.size()>0 and p.size()<min) {
-              min = p.size();
-              missing = p.front();
-            }
-          }
+      else {
+        labels[i] = best_labels(*prob[i], trace.size());
+        if (cfg->WARM_START) wcache.store(*prob[i], log.get_path(group[i]));
+      }
+
+      if (known[i].empty()) {
+        TRACE(1, "  solved. Adding model moves");
+        perf_counters::sample p0;
+        if (perf!=NULL) p0 = perf->read();
+        bool fits;
+        if (pcache!=NULL) moves[i] = pcache->complete(trace, log.get_path(group[i]), labels[i], fits);
+        else moves[i] = complete_alignment(trace, labels[i], m, fits);
+        solution = moves[i].dump();
+        fitting = fitting_name(fits);
+        if (perf!=NULL) {
+          pfill[i] = perf->read()-p0;
+          perf_events += trace.size();
         }
-       
-        if (missing.empty()) {
-          TRACE(1, "No path found to complete unfitting parallel. Likely non-fitting trace");
-          break;
+      }
+
+      clock_t t1 = clock();  // final time
+      time[i] += double(t1-t0)/double(CLOCKS_PER_SEC);
+      if (cached[i]) ++cache_hits;
+      else if (known[i].empty()) { ++rl_count; rl_time += time[i]; }
+      else { ++fast_count; fast_time += time[i]; }
+
+      if (cfg->WARM_START_COMPARE and prob[i]!=NULL) {
+        // solve again from uniform weights, to see what the warm start saved (or changed).
+        // Done after timing the variant, so the extra solve is not charged to it
+        build_labeling_problem(scratch, trace, m);
+        cold_iters += solver.solve(scratch);
+        bool cold_fits;
+        if (complete_alignment(trace, best_labels(scratch, trace.size()), m, cold_fits).dump() != solution) {
+          TRACE(1, "  warm start alignment differs from cold start");
+          ++warm_differ;
         }
+      }
 
-        TRACE(3, "   inserting ["<<missing<<"] before pos="<<pos->id);
-        seq.insert(pos, align_elem(missing, g.get_node(missing).name, "[M-REAL]"));
+      if (rcache!=NULL and not cached[i]) rcache->store(trace, solution, fitting);
 
-        // restore original list, in case we need to loop again
-        open = g.get_in_edges(p->id);
+      if (perf!=NULL) {
+        perf_build += pbuild[i];
+        perf_solve += psolve[i];
+        perf_fill += pfill[i];
+        if (cfg->PERF_COUNTERS_VARIANTS and known[i].empty()) 
+          cerr << "PERF: case " << cases[0] << " build: " << perf->summary(pbuild[i], 0, "")
+               << "; solve: " << perf->summary(psolve[i], 0, "")
+               << "; gap fill: " << perf->summary(pfill[i], 0, "") << endl;
       }
+    
+      // output all synonyms with same result.  Attribute CPU time only to the first one
+      writer.write(solution, fitting, time[i], cases, cached[i] ? NULL : &moves[i]);
+    }
+  }
+
+  long align_allocs = allocation_count()-log_allocs;
+
+  if (cfg->WARM_START) {
+    cerr << "WARM START: " << warm_seeded << " of " << log.num_variants() << " variants seeded, "
+         << rl_iters << " RL iterations";
+    if (cfg->WARM_START_COMPARE) 
+      cerr << " (cold start: " << cold_iters << " iterations, "
+           << (cold_iters>0 ? 100.0*(cold_iters-rl_iters)/cold_iters : 0) << "% saved). "
+           << warm_differ << " alignments differ from cold start";
+    cerr << endl;
+  }
 
-      p = q; // we made it fitting from p to q, skip ahead.
+  if (cfg->STATISTICS) {
+    chrono::duration<double> dm = t_model-t_start, dl = t_log-t_model, da = chrono::steady_clock::now()-t_log;
+    cerr << "STATS: wall time: model load " << dm.count() << "s, log load " << dl.count() 
+         << "s, alignment " << da.count() << "s" << endl;
+
+    // problem pool usage, and all allocations made while aligning (problem building,
+    // gap filling, output...). Growths stop once tables reach the size of the largest problem
+    long resets = scratch.get_resets(), growths = scratch.get_growths();
+    for (auto &p : pool) {
+      resets += p.get_resets();
+      growths += p.get_growths();
     }
-      --------------- END OF OLD COMPLETION PROPOSAL -------------*/
-          
-    seq.pop_front(); // remove initial node anchor.
-    while (seq.back().type=="[ANCHOR]") seq.pop_back(); // remove final node anchor(s).
-
-    TRACE(1, "Final alignment ");
-    TRACE(3, "Final alignment: "<< seq.dump());
-    TRACE(3, "Final alignment: "<< seq.dump(true));
-
-    seq.purge();
-    TRACE(1, "Purged alignment ");
-    TRACE(3, "Purged alignment: "<< seq.dump());
-    TRACE(3, "Purged alignment: "<< seq.dump(true));
-
-    string solution = seq.dump();
-        
-    while (not seq.empty() and seq.front().type=="[L]") // skip initial [L] elements, if any
-      seq.pop_front();
-
-    set<string> initial = g.get_initial_nodes();
-    set<string> final = g.get_final_nodes();
-
-    alignment::iterator pos;
-    alignment::iterator last = seq.end();
-    --last;
-    string fitting;
-    if (g.is_fitting(initial, final, seq.begin(), last, pos)) fitting = "FITTING";
-    else fitting = "NOT-FITTING";
-
-    clock_t t1 = clock();  // final time
-    double time  = double(t1-t0)/double(CLOCKS_PER_SEC);
-    
-    // output all synonyms with same result.  Attribute CPU time only to the first one
-    for (auto s : trace.second) {
-      cout << s << "  " << solution << " " << fitting << " " << time << endl;
-      time = 0;
+    cerr << "STATS: problem pool: " << pool.size()+1 << " problems, "
+         << resets << " resets, " << growths << " table growths; "
+         << align_allocs << " allocations in alignment phase ("
+         << (log.num_variants()>0 ? double(align_allocs)/log.num_variants() : 0) << " per variant)" << endl;
+
+    if (cfg->FAST_REPLAY) {
+      // estimated saving: what replayed variants would have cost at the average RL variant time
+      double saved = (rl_count>0 ? fast_count*rl_time/rl_count - fast_time : 0);
+      cerr << "STATS: token replay: " << fast_count << " of " << log.num_variants() << " variants aligned by replay in "
+           << fast_time << "s, estimated " << saved << "s saved" << endl;
     }
+
+    if (rcache!=NULL) 
+      cerr << "STATS: result cache: " << cache_hits << " of " << log.num_variants() << " variants found, "
+           << rcache->size() << " records in cache" << endl;
+
+    if (pcache!=NULL)
+      cerr << "STATS: prefix cache: " << pcache->get_hits() << " of " << pcache->get_hits()+pcache->get_misses()
+           << " events gap-filled from cache, " << pcache->size() << " states, "
+           << log.num_nodes()-1 << " distinct prefixes in log" << endl;
   }
+
+  if (perf!=NULL) {
+    // work units: constraints of the built problems (including all windows of long traces), and gap-filled events
+    cerr << "PERF: build: " << perf->summary(perf_build, perf_constraints, "constraint") << endl;
+    cerr << "PERF: solve: " << perf->summary(perf_solve, perf_constraints, "constraint") << endl;
+    cerr << "PERF: gap fill: " << perf->summary(perf_fill, perf_events, "event") << endl;
+  }
+
+  delete rcache;
+  delete pcache;
+  delete perf;
+
+  if (not cfg->TIMELINE.empty()) timeline::save(cfg->TIMELINE);
 }
 
 
@@ -0,0 +1,1079 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <cmath>
+#include <climits>
+#include <fstream>
+#include <algorithm>
+
+#include "aligner.h"
+#include "alignment.h"
+#include "util.h"
+#include "timeline.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "ALIGNER"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+///////////////////////////////////////////////////////
+/// Constructor, load model files with given prefix, and configuration file
+
+model::model(const string &basename, const string &fconfig) : model(basename, config(fconfig)) {}
+
+///////////////////////////////////////////////////////
+/// Constructor, load model files with given prefix, and use given configuration
+
+model::model(const string &basename, const config &c) :
+  cfg(c), 
+  g(basename+".bp.pnml", graph::UNFOLDING, cfg.ADD_IFS, cfg.ADD_LOOPS),
+  bptf(basename+".tf.bp"),
+  bp(basename+".tt.bp") {
+
+  g.add_node(node(node::TRANSITION, graph::DUMMY, graph::DUMMY));  // add "dummy" node
+
+  string fpaths = basename+".tt.path";
+  TRACE(1, "Loading paths..."<<fpaths);
+  timeline::scope ts("load paths");
+  g.load_paths(fpaths);
+
+  TRACE(7, "BP without loops is: " << bptf.dump(true));
+  TRACE(7, "BP with loops is: " << bp.dump(true));
+}
+
+///////////////////////////////////////////////////////
+/// Destructor
+
+model::~model() {}
+
+///////////////////////////////////////////////////////
+/// check that all model files with given prefix and the configuration 
+/// file can be read, since loading them crashes if they can not.
+
+bool model::available(const string &basename, const string &fconfig) {
+  bool ok = ifstream(fconfig).good();
+  for (string ext : {".bp.pnml", ".tt.path", ".tf.bp", ".tt.bp"}) 
+    ok = ok and ifstream(basename+ext).good();
+  return ok;
+}
+
+
+///////////////////////////////////////////////////////
+/// check that the loaded files are consistent: the net has transitions, 
+/// and the BP with loops relates every pair of them (constraints are
+/// built from it, and a missing relation is a fatal error when aligning).
+/// Returns an error message, or an empty string if they are.
+
+string model::check() const {
+  vector<string> trans;
+  for (auto &id : g.get_nodes_by_id()) 
+    if (id!=graph::DUMMY and g.get_node(id).type==node::TRANSITION) trans.push_back(id);
+  if (trans.empty()) return "no transitions in model net";
+
+  for (auto &t1 : trans)
+    for (auto &t2 : trans) 
+      if (bp.get_relation(t1,t2)==behavioral_profile::NO_RELATION) 
+        return "missing BP relation for pair " + t1 + " " + t2;
+  return "";
+}
+
+
+///////////////////////////////////////////////////////
+/// Constructor
+
+aligner::aligner(const model &md) : m(md), 
+                                    solver(md.cfg.MAX_ITER, md.cfg.SCALE_FACTOR, md.cfg.EPSILON, md.cfg.PRUNE_THRESHOLD),
+                                    iterations(0) {}
+
+///////////////////////////////////////////////////////
+/// Destructor
+
+aligner::~aligner() {}
+
+///////////////////////////////////////////////////////
+/// align a trace: by plain replay if it fits and FastReplay is on,
+/// by windows if it is longer than WindowSize, or solving a single
+/// RL problem otherwise. Returns the alignment, and whether it fits
+/// the model.
+
+alignment aligner::align(const vector<string> &trace, bool &fitting) {
+
+  alignment seq;
+  if (m.cfg.FAST_REPLAY and replay_alignment(trace, m, seq)) {
+    TRACE(1, "  Trace fits by replay, no RL needed");
+    fitting = true;
+    return seq;
+  }
+
+  vector<string> labels;
+  if (m.cfg.WINDOW_SIZE>0 and int(trace.size())>m.cfg.WINDOW_SIZE) {
+    TRACE(1, "  Solving RL problem size="<<trace.size()<<" by windows");
+    labels = solve_windowed(trace, m, solver, prob, iterations);
+  }
+  else {
+    TRACE(1, "  Creating RL problem size="<<trace.size());
+    build_labeling_problem(prob, trace, m);
+    TRACE(1, "  solving RL problem");
+    iterations += solver.solve(prob);
+    labels = best_labels(prob, trace.size());
+  }
+
+  TRACE(1, "  solved. Adding model moves");
+  return complete_alignment(trace, labels, m, fitting);
+}
+
+///////////////////////////////////////////////////////
+/// align several traces. Short traces are solved together by the 
+/// batched RL solver, the others as in single trace alignment.
+/// Returns the alignments, and whether each fits the model.
+
+vector<alignment> aligner::align(const vector<vector<string> > &traces, vector<bool> &fitting) {
+
+  vector<alignment> result(traces.size());
+  fitting.assign(traces.size(), false);
+
+  // problem in the pool used by each trace (-1 if none), and its labels and constrained pairs
+  vector<int> used(traces.size(), -1);
+  vector<labeling_structure> structs;
+  int nprobs = 0;
+  for (size_t i=0; i<traces.size(); ++i) {
+    bool fits;
+    if (m.cfg.FAST_REPLAY and replay_alignment(traces[i], m, result[i])) 
+      fitting[i] = true;
+    else if (m.cfg.WINDOW_SIZE>0 and int(traces[i].size())>m.cfg.WINDOW_SIZE) {
+      result[i] = complete_alignment(traces[i], solve_windowed(traces[i], m, solver, prob, iterations), m, fits);
+      fitting[i] = fits;
+    }
+    else {
+      if (nprobs == int(pool.size())) pool.push_back(problem());
+      used[i] = nprobs++;
+      structs.emplace_back(traces[i], m);
+    }
+  }
+
+  if (nprobs==0) return result;
+
+  // add problems to the batch, with their constraints straight into the batch tables
+  batch.clear();
+  for (int k=0; k<nprobs; ++k) {
+    structs[k].build_labels(pool[k], m.cfg);
+    batch.add_labels(pool[k]);
+    structs[k].build_constraints(batch, m.cfg);
+  }
+
+  TRACE(1, "  solving batch of "<<nprobs<<" RL problems");
+  solver.solve(batch);
+  batch.unpack();
+  for (int k=0; k<batch.size(); ++k) iterations += batch.get_iterations(k);
+
+  for (size_t i=0; i<traces.size(); ++i) {
+    if (used[i]<0) continue;
+    bool fits;
+    result[i] = complete_alignment(traces[i], best_labels(pool[used[i]], traces[i].size()), m, fits);
+    fitting[i] = fits;
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////
+/// RL iterations performed so far
+
+long aligner::get_iterations() const {
+  return iterations;
+}
+
+
+///////////////////////////////////////////////////////
+/// add labels (possible alignments) to variables (trace events)
+/// in a RL constraint satisfaction problem. Only variables from
+/// 'from' onwards are considered (the others already have labels)
+
+void add_variable_labels(problem & prob,
+                         const vector<string> &trace,
+                         const graph& g,
+                         const config &cfg,
+                         size_t from) {
+
+  // add possible alignments for each event
+  for (size_t nv=from; nv<trace.size(); ++nv) {
+    TRACE(2, "Adding variable " << nv << " " << trace[nv]);
+    prob.set_var_name(nv, trace[nv]);
+    // get candidates to be aligned
+    list<string> labels = g.get_nodes_by_name(trace[nv]);
+    // add them as labels for variable nv
+    int nl=0;
+    for (auto id : labels) {
+      TRACE(2, "     label " << nl << " " << id);
+      prob.add_label(nv, (1.0-cfg.DUMMY_INITIAL_WEIGHT)/labels.size(), id);
+      ++nl;
+    }
+    // add an extra dummy label
+    prob.add_label(nv, cfg.DUMMY_INITIAL_WEIGHT, graph::DUMMY);
+  }
+}
+
+///////////////////////////////////////////////////////
+/// add constraints (BP restrictions) between
+/// labels (possible alignments).  Only constraints involving
+/// events from 'from' onwards are added (the others already exist)
+
+void add_constraints(problem &prob,
+                     const vector<string> &trace,
+                     const model &m,
+                     int from) {
+  labeling_structure(prob, trace, m, from).build_constraints(prob, m.cfg);
+}
+
+///////////////////////////////////////////////////////
+/// fill a constraint satisfaction problem using event, 
+/// alignment, and BP information. The given problem object
+/// is reset and reused, to avoid reallocating its tables.
+
+void build_labeling_problem(problem &prob,
+                            const vector<string> &trace,
+                            const model &m) {
+
+  timeline::scope ts("build", trace.size());
+  // find labels and constrained pairs of each event, and turn
+  // them into weighted constraints for the current configuration
+  TRACE(1, "Adding variables and constraints ");
+  labeling_structure(trace, m).build_problem(prob, m.cfg);
+}
+
+
+///////////////////////////////////////////////////////
+/// Constructor: find labels (tasks with the name of each event)
+/// and constrained label pairs of a trace
+
+labeling_structure::labeling_structure(const vector<string> &trace, const model &m, 
+                                       int max_dist, bool balances, bool dummies) : vars(trace) {
+  labels.resize(trace.size());
+  for (size_t ev=0; ev<trace.size(); ++ev) {
+    list<string> lbs = m.g.get_nodes_by_name(trace[ev]);
+    labels[ev].assign(lbs.begin(), lbs.end());
+  }
+  find_constraints(m, max_dist, balances, dummies, 0);
+}
+
+///////////////////////////////////////////////////////
+/// Constructor: structure for the model configuration, with balances
+/// only if some compatibility is progressive, and dummy triples only
+/// if dummy compatibility is used
+
+labeling_structure::labeling_structure(const vector<string> &trace, const model &m) :
+  labeling_structure(trace, m, m.cfg.MAX_DIST, m.cfg.ORDER_PROGRESSIVE or m.cfg.PARALLEL_PROGRESSIVE,
+                     m.cfg.DUMMY_COMPAT!=0) {}
+
+///////////////////////////////////////////////////////
+/// Constructor: labels of an existing problem for the trace (which
+/// may have been pruned), and the constraints involving events from
+/// 'from' onwards, for the model configuration
+
+labeling_structure::labeling_structure(const problem &prob, const vector<string> &trace, const model &m, int from) : vars(trace) {
+  labels.resize(trace.size());
+  for (size_t ev=0; ev<trace.size(); ++ev) 
+    for (int lb=0; lb<prob.get_num_labels(ev); ++lb) {
+      // the dummy label (the last one) has no constraints
+      string name = prob.get_label_name(ev,lb);
+      if (name != graph::DUMMY) labels[ev].push_back(name);
+    }
+  find_constraints(m, m.cfg.MAX_DIST, m.cfg.ORDER_PROGRESSIVE or m.cfg.PARALLEL_PROGRESSIVE,
+                   m.cfg.DUMMY_COMPAT!=0, from);
+}
+
+///////////////////////////////////////////////////////
+/// find the constrained label pairs (up to max_dist events apart,
+/// 0 = all) and dummy triples involving events from 'from' onwards,
+/// keeping the BP relations and distances instead of compatibility values
+
+void labeling_structure::find_constraints(const model &m, int max_dist, bool balances, bool dummies, int from) {
+
+  const graph &g = m.g;
+  int M = vars.size();
+
+  // difference between events position in the trace and distance in the model
+  // between their labels (add one to avoid zeros)
+  auto balance = [&g](int ev1, const string &t1, int ev2, const string &t2) {
+    double dg = g.distance(t1, t2);
+    double dt = abs(ev1-ev2);
+    TRACE(4, "  distance_balance "<<t1<<" "<<t2<<" dg="<<dg<<" dt="<<dt);
+    return abs(dt-dg) + 1;
+  };
+
+  // longest ngram to consider (all the length if max_dist==0)
+  int md = (max_dist!=0 ? max_dist : 2*g.get_num_nodes());
+  for (int ev1=std::max(0,from-md); ev1<M; ++ev1) {
+    for (int ev2=std::max(ev1+1,from); ev2<=std::min(M-1, ev1+md); ++ev2) {
+      for (int lb1=0; lb1<int(labels[ev1].size()); ++lb1) {
+        for (int lb2=0; lb2<int(labels[ev2].size()); ++lb2) {
+          const string &t1 = labels[ev1][lb1];
+          const string &t2 = labels[ev2][lb2];
+
+          label_pair p;
+          p.ev1 = ev1; p.lb1 = lb1; p.ev2 = ev2; p.lb2 = lb2;
+          p.relation = m.bp.get_relation(t1,t2);
+          p.same = (t1 == t2);
+          p.balance12 = p.balance21 = 1;
+          if (balances and p.relation==behavioral_profile::PRECEDES)
+            p.balance12 = balance(ev1, t1, ev2, t2);
+          else if (balances and p.relation==behavioral_profile::INTERLEAVED) {
+            // "real" paralels get no penalty for long paths
+            if (m.bptf.get_relation(t1,t2)!=behavioral_profile::INTERLEAVED) p.balance12 = balance(ev1, t1, ev2, t2);
+            if (m.bptf.get_relation(t2,t1)!=behavioral_profile::INTERLEAVED) p.balance21 = balance(ev2, t2, ev1, t1);
+          }
+          pairs.push_back(p);
+        }
+      }
+    }
+  }
+
+  if (not dummies) return;
+
+  // constraints favoring dummy label ([L])
+  // Given events A X B, if aligning X would create a path between A and B longer than
+  // the A-B path if X is ommited, penalize the alignment of X
+  for (int ev=std::max(1,from-1); ev<M-1; ++ev) {
+    int evL = ev-1;
+    int evR = ev+1;
+    for (int lb=0; lb<int(labels[ev].size()); ++lb) {
+      const string &te = labels[ev][lb];
+      for (int lbL=0; lbL<int(labels[evL].size()); ++lbL) {
+        for (int lbR=0; lbR<int(labels[evR].size()); ++lbR) {
+          const string &tL = labels[evL][lbL];
+          const string &tR = labels[evR][lbR];
+
+          double dLR = -1;
+          if (m.bptf.get_relation(tL,tR)==behavioral_profile::INTERLEAVED) dLR = 0;
+          else if (g.path_exists(tL,tR)) dLR = g.distance(tL,tR);
+
+          double dLe = -1;
+          if (m.bptf.get_relation(tL,te)==behavioral_profile::INTERLEAVED) dLe = 0;
+          else if (g.path_exists(tL,te)) dLe = g.distance(tL,te);
+
+          double deR = -1;
+          if (m.bptf.get_relation(te,tR)==behavioral_profile::INTERLEAVED) deR = 0;
+          else if (g.path_exists(te,tR)) deR = g.distance(te,tR);
+
+          TRACE(5, "checking Dummy compatibility constraint "<<tL<<"-["<<te<<"]-"<<tR<<" "<<dLR<<" "<<dLe<<" "<<deR );
+          if (dLR>=0 and dLe>=0 and deR>=0 and dLR < dLe+deR-1) {
+            dummy_triple d;
+            d.ev = ev; d.lb = lb; d.evL = evL; d.lbL = lbL; d.evR = evR; d.lbR = lbR;
+            d.excess = dLe+deR-1-dLR;
+            triples.push_back(d);
+          }
+        }
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////
+/// Destructor
+
+labeling_structure::~labeling_structure() {}
+
+///////////////////////////////////////////////////////
+/// fill the problem for the trace with given configuration. Labels and
+/// constraints are added in the same order as add_variable_labels and
+/// add_constraints do, so incremental problems match the full ones.
+
+void labeling_structure::build_problem(problem &prob, const config &cfg) const {
+  build_labels(prob, cfg);
+  add_constraints(prob, cfg);
+}
+
+///////////////////////////////////////////////////////
+/// reset the problem and add the variables and labels of the trace
+
+void labeling_structure::build_labels(problem &prob, const config &cfg) const {
+
+  int M = vars.size();
+  prob.reset(M);
+  for (int nv=0; nv<M; ++nv) {
+    prob.set_var_name(nv, vars[nv]);
+    for (auto &id : labels[nv])
+      prob.add_label(nv, (1.0-cfg.DUMMY_INITIAL_WEIGHT)/labels[nv].size(), id);
+    prob.add_label(nv, cfg.DUMMY_INITIAL_WEIGHT, graph::DUMMY);
+  }
+}
+
+///////////////////////////////////////////////////////
+/// add the constraints of the last problem packed in the batch
+/// straight into the batch tables: they are counted, their room
+/// is reserved, and then they are stored.
+
+void labeling_structure::build_constraints(problem_batch &batch, const config &cfg) const {
+  add_constraints(batch, cfg);
+  batch.place_constraints();
+  add_constraints(batch, cfg);
+}
+
+///////////////////////////////////////////////////////
+/// add the constraints to a problem filled by build_labels
+
+void labeling_structure::build_constraints(problem &prob, const config &cfg) const {
+  add_constraints(prob, cfg);
+}
+
+///////////////////////////////////////////////////////
+/// add the constraints for given configuration to a problem or
+/// to a problem batch, which have the same add_constraint methods
+
+template <class T>
+void labeling_structure::add_constraints(T &prob, const config &cfg) const {
+
+  int md = (cfg.MAX_DIST!=0 ? cfg.MAX_DIST : INT_MAX);
+  for (auto &p : pairs) {
+    if (p.ev2-p.ev1 > md) continue;
+
+    if (cfg.REPEAT_COMPAT!=0 and p.same) {
+      // added twice, as it always was, to keep results unchanged
+      prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.REPEAT_COMPAT);
+      prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.REPEAT_COMPAT);
+      continue;
+    }
+
+    switch (p.relation) {
+      case behavioral_profile::NO_RELATION :
+        ERROR_CRASH("Invalid or missing BP relation for pair "
+                    << labels[p.ev1][p.lb1] << " " << labels[p.ev2][p.lb2]);
+
+      case behavioral_profile::PRECEDES :
+        if (cfg.ORDER_COMPAT!=0) {
+          double diff = (cfg.ORDER_PROGRESSIVE ? p.balance12 : 1.0);
+          prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.ORDER_COMPAT/diff);
+          prob.add_constraint(p.ev2, p.lb2, p.ev1, p.lb1, cfg.ORDER_COMPAT/diff);
+        }
+        break;
+
+      case behavioral_profile::FOLLOWS :
+        if (cfg.CROSS_COMPAT!=0) {
+          prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.CROSS_COMPAT);
+          prob.add_constraint(p.ev2, p.lb2, p.ev1, p.lb1, cfg.CROSS_COMPAT);
+        }
+        break;
+
+      case behavioral_profile::EXCLUSIVE :
+        if (cfg.EXCLUSIVE_COMPAT!=0) {
+          prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.EXCLUSIVE_COMPAT);
+          prob.add_constraint(p.ev2, p.lb2, p.ev1, p.lb1, cfg.EXCLUSIVE_COMPAT);
+        }
+        break;
+
+      case behavioral_profile::INTERLEAVED :
+        if (cfg.PARALLEL_COMPAT!=0) {
+          double diff = (cfg.PARALLEL_PROGRESSIVE ? p.balance12 : 1.0);
+          prob.add_constraint(p.ev1, p.lb1, p.ev2, p.lb2, cfg.PARALLEL_COMPAT/diff);
+          diff = (cfg.PARALLEL_PROGRESSIVE ? p.balance21 : 1.0);
+          prob.add_constraint(p.ev2, p.lb2, p.ev1, p.lb1, cfg.PARALLEL_COMPAT/diff);
+        }
+        break;
+    }
+  }
+
+  if (cfg.DUMMY_COMPAT!=0) {
+    for (auto &d : triples)
+      prob.add_constraint(d.ev, d.lb, d.evL, d.lbL, d.evR, d.lbR, cfg.DUMMY_COMPAT*d.excess);
+  }
+}
+
+
+
+///////////////////////////////////////////////////////
+/// get the name of the best label for each variable of a solved RL problem
+
+vector<string> best_labels(const problem& prob, int nvars) {
+  vector<string> labels(nvars);
+  for (int nv=0; nv<nvars; ++nv) 
+    labels[nv] = prob.get_label_name(nv, prob.best_label(nv).front());
+  return labels;
+}
+
+///////////////////////////////////////////////////////
+/// solve the RL problem for a long trace using overlapping windows
+/// of WindowSize events. Variables in the overlap with the 
+/// previous window are pinned to the weights obtained there, so
+/// memory depends only on the window size. The given problem object
+/// is reused for all windows. Returns the stitched best labels for
+/// the whole trace, and adds the constraints of all windows to
+/// 'constraints' if given.
+
+vector<string> solve_windowed(const vector<string> &trace,
+                              const model &m,
+                              const relax &solver,
+                              problem &prob,
+                              long &iters,
+                              long *constraints) {
+
+  timeline::scope ts("solve windows", trace.size());
+  int N = trace.size();
+  int W = m.cfg.WINDOW_SIZE;
+  int overlap = (m.cfg.WINDOW_OVERLAP>0 ? m.cfg.WINDOW_OVERLAP
+                 : m.cfg.MAX_DIST>0 ? m.cfg.MAX_DIST : W/2);
+  overlap = std::min(overlap, W/2);
+
+  vector<string> labels(N);
+  // weights of the pinned variables, by label name
+  vector<vector<pair<string,double> > > pinned;
+  
+  int start = 0;
+  while (true) {
+    int end = std::min(start+W, N);
+    TRACE(2, "  solving window ["<<start<<","<<end<<") of "<<N);
+    vector<string> window(trace.begin()+start, trace.begin()+end);
+    build_labeling_problem(prob, window, m);
+    if (constraints!=NULL) *constraints += prob.get_num_constraints();
+
+    // pin variables shared with the previous window
+    for (size_t nv=0; nv<pinned.size(); ++nv) {
+      for (int j=0; j<prob.get_num_labels(nv); ++j) {
+        double w = 0;
+        for (auto &p : pinned[nv]) 
+          if (p.first == prob.get_label_name(nv,j)) { w = p.second; break; }
+        prob.set_label_weight(nv, j, w);
+      }
+      prob.fix_variable(nv);
+    }
+
+    iters += solver.solve(prob);
+
+    // keep best labels for the variables this window decided
+    for (int nv=pinned.size(); nv<end-start; ++nv) 
+      labels[start+nv] = prob.get_label_name(nv, prob.best_label(nv).front());
+
+    if (end == N) break;
+
+    // remember weights for the overlapping part and slide the window
+    int next = end-overlap;
+    pinned.clear();
+    for (int nv=next-start; nv<end-start; ++nv) {
+      vector<pair<string,double> > w;
+      for (int j=0; j<prob.get_num_labels(nv); ++j)
+        w.push_back(make_pair(prob.get_label_name(nv,j), prob.get_label_weight(nv,j)));
+      pinned.push_back(w);
+    }
+    start = next;
+  }
+
+  return labels;
+}
+
+///////////////////////////////////////////////////////
+/// try to align the trace by direct token replay on the model.
+/// If it fits (with no model moves needed), the alignment is made
+/// only of synchronous moves, and is returned in 'seq'.
+
+bool replay_alignment(const vector<string> &trace, const model &m, alignment &seq) {
+
+  timeline::scope ts("replay", trace.size());
+  vector<string> fired;
+  if (not m.g.replay(trace, fired, m.cfg.FAST_REPLAY_LIMIT)) return false;
+
+  seq = alignment(m.g, trace);
+  for (size_t i=0; i<trace.size(); ++i) 
+    seq.push_back(align_elem(align_elem::SYNC, m.g.get_index(fired[i]), i));
+  return true;
+}
+
+///////////////////////////////////////////////////////
+/// move for the event at given position with given label: a log move
+/// if it is the dummy label, a sync move with the labelled transition otherwise
+
+align_elem label_move(const graph &g, const string &label, uint32_t ev) {
+  if (label == graph::DUMMY) return align_elem(align_elem::LOG, align_elem::NONE, ev);
+  return align_elem(align_elem::SYNC, g.get_index(label), ev);
+}
+
+///////////////////////////////////////////////////////
+/// create an alignment from the best labels of a solved RL problem
+
+alignment RL_to_alignment(const graph& g, const vector<string> &trace, const vector<string> &labels) {
+  
+  alignment seq(g, trace);
+  seq.reserve(2*trace.size());
+  for (auto n : g.get_initial_nodes())
+    seq.push_back(align_elem(align_elem::ANCHOR, g.get_index(n))); // initial place, to anchor the sequence
+  
+  for (size_t nv=0; nv<trace.size(); ++nv) 
+    seq.push_back(label_move(g, labels[nv], nv));
+  
+  for (auto n : g.get_final_nodes())
+    seq.push_back(align_elem(align_elem::ANCHOR, g.get_index(n))); // final place, to anchor the sequence
+  
+  return seq;
+}
+
+  
+///////////////////////////////////////////////////////
+/// add missing model moves to an alignment
+
+void add_model_moves(alignment &seq, const graph &g, const behavioral_profile &bptf) {
+  if (seq.empty()) return;
+
+  // the alignment is rebuilt adding model moves before each element
+  vector<align_elem> elems(seq.begin()+1, seq.end());
+  seq.erase(seq.begin()+1, seq.end());  // start at second element (first is the anchor, initial place)
+  string pprev = seq.id(seq.front());
+  for (auto &p : elems) {
+    
+    if (p.type != align_elem::LOG) {   // skip deletions
+      
+      const string &pid = seq.id(p);
+      if (g.path_exists(pprev,pid) and bptf.get_relation(pprev,pid)!=behavioral_profile::INTERLEAVED) {
+        list<string> mreal = g.path(pprev,pid);
+        for (auto m : mreal) {
+          if (g.get_node(m).type == node::TRANSITION)
+            seq.push_back(align_elem(align_elem::MODEL, g.get_index(m)));
+        }
+      }
+      
+      pprev = pid; // 'pprev' remembers is the last non-deletion element seen
+    }
+    
+    seq.push_back(p);
+  }
+  
+}
+
+///////////////////////////////////////////////////////
+/// fill the gaps of an alignment from position 'from' with model moves,
+/// firing transitions from the given marking. Events that can not
+/// be reached are turned into log moves.  The marking reached at
+/// the end is left in 'open'.
+
+void fill_gaps(alignment &seq, size_t from, set<string> &open, const graph &g) {
+
+  // elements from 'from' on are moved out, and added back with the model moves filling their gaps
+  vector<align_elem> elems(seq.begin()+from, seq.end());
+  seq.erase(seq.begin()+from, seq.end());
+
+  for (auto p : elems) {
+    if (p.type==align_elem::LOG) {
+      seq.push_back(p);
+      continue;
+    }
+
+    // p.type is [L/M]. Find a path to p current PN state (maybe empty if p can already be fired)
+    const string &pid = g.get_node(p.node).id;
+    list<string> mreal;
+    if (g.find_path(open, pid, mreal)) {
+      // there is a path that can fill the gap:  Fill the gap with the shortest path
+      mreal.pop_back(); // Last element is p.id, remove it
+      for (auto m : mreal) {
+        if (g.get_node(m).type == node::TRANSITION) {
+          seq.push_back(align_elem(align_elem::MODEL, g.get_index(m)));
+          open = g.fire_transition(open, m);
+        }
+      }
+      // we are good up to p, move to next event
+      open = g.fire_transition(open, pid);
+      seq.push_back(p);
+      continue;
+    }
+
+    // p.type is [L/M], and there is no possible set of model moves that will fix this.
+    // Try removing p, to find a path to element after p
+    if (p.type == align_elem::SYNC) {
+      TRACE(3,"No path found to fill the gap. Removing next event "<<seq.name(p)<<" ("<<pid<<")");
+      p.type = align_elem::LOG;
+      seq.push_back(p);
+    }
+    else if (p.type == align_elem::ANCHOR) {
+      TRACE(3,"No path found to final state "<<pid<<". Removing anchor.");
+    }
+    else {
+      // should not happen
+      ERROR_CRASH("Unexpected element "<<seq.dump(p,true)<<" in gap filling process");
+    }
+
+  }
+}
+
+///////////////////////////////////////////////////////
+/// remove anchors from a gap-filled alignment, purge it, and check fitness.
+/// Returns whether the alignment fits the model.
+
+bool finish_alignment(alignment &seq, const graph &g) {
+
+  seq.erase(seq.begin()); // remove initial node anchor.
+  while (not seq.empty() and seq.back().type==align_elem::ANCHOR) seq.pop_back(); // remove final node anchor(s).
+
+  TRACE(1, "Final alignment ");
+  TRACE(3, "Final alignment: "<< seq.dump());
+  TRACE(3, "Final alignment: "<< seq.dump(true));
+
+  seq.purge();
+  TRACE(1, "Purged alignment ");
+  TRACE(3, "Purged alignment: "<< seq.dump());
+  TRACE(3, "Purged alignment: "<< seq.dump(true));
+
+  alignment::iterator first = seq.begin();
+  while (first!=seq.end() and first->type==align_elem::LOG) // skip initial [L] elements, if any
+    ++first;
+
+  set<string> initial = g.get_initial_nodes();
+  set<string> final = g.get_final_nodes();
+
+  // no model moves at all: it fits only if the initial marking is final
+  if (first==seq.end()) return includes(final.begin(), final.end(), initial.begin(), initial.end());
+
+  alignment::iterator pos;
+  alignment::iterator last = seq.end();
+  --last;
+  return g.is_fitting(initial, final, first, last, pos);
+}
+
+///////////////////////////////////////////////////////
+/// name of the fitness status of an alignment, as printed in results
+
+string fitting_name(bool fitting) {
+  return fitting ? "FITTING" : "NOT-FITTING";
+}
+
+///////////////////////////////////////////////////////
+/// build the final alignment from the best labels of a solved RL problem:
+/// fill gaps with model moves, purge it, and check fitness.
+/// Returns the alignment, and whether it fits the model via 'fitting'
+
+alignment complete_alignment(const vector<string> &trace, const vector<string> &labels, const model &m, bool &fitting) {
+
+  timeline::scope ts("gap fill", trace.size());
+  const graph &g = m.g;
+
+  // extract solution and create a (partially) aligned sequence
+  alignment seq = RL_to_alignment(g, trace, labels);
+  TRACE(3, "initial alignment: "<< seq.dump());
+  TRACE(3, "initial alignment: "<< seq.dump(true));
+
+  /*  --------------- BEGIN OF NEW COMPLETION PROPOSAL -------------*/
+  set<string> open = g.get_initial_nodes();
+  fill_gaps(seq, 1, open, g); // skip anchor
+  
+  /*  --------------- END OF NEW COMPLETION PROPOSAL -------------*/
+
+  /*  --------------- BEGIN OF OLD COMPLETION PROPOSAL -------------    
+  // complete sequence with missing model moves
+  add_model_moves(seq, g, bptf);    
+  TRACE(1, "Completed alignment ");
+  TRACE(3, "Completed alignment: "<< seq.dump());
+  TRACE(3, "Completed alignment: "<< seq.dump(true));
+
+  p = seq.begin(); ++p;
+  while (p!=seq.end()) {
+
+    // skip deletions, and look for a parallel split
+    if (p->type=="[L]" or not g.is_parallel_split(p->id)) {
+      ++p;
+      continue;
+    }
+
+    TRACE(3, "found split "<<p->id);
+    
+    // it is a parallel split, find its closing join
+    string match = g.find_matching_join(p->id);
+    TRACE(3, "parallel join "<<match<<" found to match split "<<p->id);
+    
+    // locate closing join in the trace, ahead of p
+    alignment::iterator q(p);  
+    while (q!=seq.end() and (q->type=="[L]" or q->id!=match) ) ++q;
+    if (q==seq.end()) {
+      TRACE(1, "No matching parallel join for "<< p->id <<" was found in the trace. Likely non-fitting trace");
+      break;
+    }
+    
+    set<string> open = g.get_in_edges(p->id);
+    set<string> final = g.get_out_edges(q->id);
+    alignment::iterator pos;
+    while (not g.is_fitting(open, final, p, q, pos, false)) {
+      TRACE(3, "parallel section not fitting! "<<p->id<<" "<<match);
+      
+      // see which states remained opened and shouldn't.
+      set<string> remaining = difference_set(open,final);
+      
+      TRACE(3, " nonfinal remaining opened =["<<set2string(remaining)<<"]   pos="<<pos->id);
+
+      // shortest non-empty path from opened nonfinal to pos.
+      string missing;
+      size_t min=9999999;
+      for (auto r : remaining) {
+        if (g.path_exists(r,pos->id)) {
+          list<string> p = g.path(r,pos->id);
+          if (p.size()>0 and p.size()<min) {
+            min = p.size();
+            missing = p.front();
+          }
+        }
+      }
+     
+      if (missing.empty()) {
+        TRACE(1, "No path found to complete unfitting parallel. Likely non-fitting trace");
+        break;
+      }
+
+      TRACE(3, "   inserting ["<<missing<<"] before pos="<<pos->id);
+      seq.insert(pos, align_elem(missing, g.get_node(missing).name, "[M-REAL]"));
+
+      // restore original list, in case we need to loop again
+      open = g.get_in_edges(p->id);
+    }
+
+    p = q; // we made it fitting from p to q, skip ahead.
+  }
+    --------------- END OF OLD COMPLETION PROPOSAL -------------*/
+        
+  fitting = finish_alignment(seq, g);
+  return seq;
+}
+
+
+///////////////////////////////////////////////////////
+/// Constructor. The committed alignment starts with the initial anchor.
+
+online_case::online_case(const model &md) : m(md), 
+                                            solver(md.cfg.MAX_ITER, md.cfg.SCALE_FACTOR, md.cfg.EPSILON, md.cfg.PRUNE_THRESHOLD),
+                                            done(md.g), iterations(0) {
+  // window as in solve_windowed, with a default size if WindowSize is not set
+  size = (m.cfg.WINDOW_SIZE>0 ? m.cfg.WINDOW_SIZE : 20);
+  overlap = (m.cfg.WINDOW_OVERLAP>0 ? m.cfg.WINDOW_OVERLAP
+             : m.cfg.MAX_DIST>0 ? m.cfg.MAX_DIST : size/2);
+  overlap = std::min(overlap, size/2);
+
+  for (auto n : m.g.get_initial_nodes())
+    done.push_back(align_elem(align_elem::ANCHOR, m.g.get_index(n))); // initial place, to anchor the sequence
+  open = m.g.get_initial_nodes();
+  fill_gaps(done, 1, open, m.g);
+
+  prob.reset(0);
+}
+
+///////////////////////////////////////////////////////
+/// Destructor
+
+online_case::~online_case() {}
+
+///////////////////////////////////////////////////////
+/// add next event of the case: extend the window problem with a new
+/// variable and its constraints, and re-relax it with the variables
+/// out of reach of the new constraints pinned.
+/// Returns the provisional alignment of the not committed events.
+
+alignment online_case::append(const string &event) {
+
+  if (int(window.size()) == size) slide();
+
+  window.push_back(event);
+  int v = prob.add_variable(event);
+  add_variable_labels(prob, window, m.g, m.cfg, v);
+  add_constraints(prob, window, m, v);
+
+  // only the neighbourhood of the new event is relaxed again
+  int md = (m.cfg.MAX_DIST!=0 ? m.cfg.MAX_DIST : 2*m.g.get_num_nodes()); 
+  for (int nv=0; nv<v-md; ++nv) prob.fix_variable(nv);
+  iterations += solver.solve(prob);
+
+  // gap-fill current labels of the window from the committed marking
+  alignment seq(m.g, window);
+  vector<string> labels = best_labels(prob, window.size());
+  for (size_t nv=0; nv<window.size(); ++nv) 
+    seq.push_back(label_move(m.g, labels[nv], nv));
+  set<string> marking = open;
+  fill_gaps(seq, 0, marking, m.g);
+  return seq;
+}
+
+///////////////////////////////////////////////////////
+/// commit the oldest events of the window: their labels are gap-filled
+/// from the current marking and added to the alignment. The window
+/// problem is rebuilt with the remaining events pinned to their weights,
+/// as solve_windowed does.
+
+void online_case::slide() {
+
+  int keep = overlap;
+  TRACE(2, "  committing "<<window.size()-keep<<" events of the window");
+
+  // commit labels of the events leaving the window
+  vector<string> labels = best_labels(prob, window.size());
+  size_t p = done.size();
+  for (size_t nv=0; nv<window.size()-keep; ++nv) 
+    done.push_back(label_move(m.g, labels[nv], done.add_event(window[nv])));
+  fill_gaps(done, p, open, m.g);
+
+  // remember weights of the remaining events, and restart the window with them
+  pinned.clear();
+  for (size_t nv=window.size()-keep; nv<window.size(); ++nv) {
+    vector<pair<string,double> > w;
+    for (int j=0; j<prob.get_num_labels(nv); ++j)
+      w.push_back(make_pair(prob.get_label_name(nv,j), prob.get_label_weight(nv,j)));
+    pinned.push_back(w);
+  }
+  window.erase(window.begin(), window.end()-keep);
+  rebuild();
+}
+
+///////////////////////////////////////////////////////
+/// build the window problem from scratch, with the events
+/// shared with the previous window pinned to their weights
+
+void online_case::rebuild() {
+
+  build_labeling_problem(prob, window, m);
+  for (size_t nv=0; nv<pinned.size(); ++nv) {
+    for (int j=0; j<prob.get_num_labels(nv); ++j) {
+      double w = 0;
+      for (auto &p : pinned[nv]) 
+        if (p.first == prob.get_label_name(nv,j)) { w = p.second; break; }
+      prob.set_label_weight(nv, j, w);
+    }
+    prob.fix_variable(nv);
+  }
+}
+
+///////////////////////////////////////////////////////
+/// finish the case: relax the whole window again (as the batch aligner 
+/// would), add its labels and the final anchors to the committed 
+/// alignment, fill the remaining gaps, and check fitness.
+
+alignment online_case::close(bool &fitting) {
+
+  rebuild();
+  iterations += solver.solve(prob);
+
+  vector<string> labels = best_labels(prob, window.size());
+  size_t p = done.size();
+  for (size_t nv=0; nv<window.size(); ++nv) 
+    done.push_back(label_move(m.g, labels[nv], done.add_event(window[nv])));
+  for (auto n : m.g.get_final_nodes()) 
+    done.push_back(align_elem(align_elem::ANCHOR, m.g.get_index(n))); // final place, to anchor the sequence
+  fill_gaps(done, p, open, m.g);
+
+  fitting = finish_alignment(done, m.g);
+  return done;
+}
+
+///////////////////////////////////////////////////////
+/// RL iterations performed so far
+
+long online_case::get_iterations() const {
+  return iterations;
+}
+
+
+///////////////////////////////////////////////////////
+/// Constructor. State 0 is the marking after the initial anchors.
+
+prefix_cache::prefix_cache(const model &md) : m(md), states(1), hits(0), misses(0) {
+  alignment seq(m.g);
+  for (auto n : m.g.get_initial_nodes())
+    seq.push_back(align_elem(align_elem::ANCHOR, m.g.get_index(n))); // initial place, to anchor the sequence
+  states[0].open = m.g.get_initial_nodes();
+  fill_gaps(seq, 1, states[0].open, m.g);
+  states[0].seg.assign(seq.begin(), seq.end());
+}
+
+///////////////////////////////////////////////////////
+/// Destructor
+
+prefix_cache::~prefix_cache() {}
+
+///////////////////////////////////////////////////////
+/// build the final alignment from the best labels of a solved RL problem,
+/// reusing gap-filling states of previous alignments sharing a prefix with
+/// this one (same trie nodes and same labels).  New states are added
+/// until the cache is full; after that, the rest of the trace is just
+/// gap-filled as complete_alignment would do.
+
+alignment prefix_cache::complete(const vector<string> &trace, const vector<uint32_t> &path,
+                                 const vector<string> &labels, bool &fitting) {
+
+  timeline::scope ts("gap fill", trace.size());
+  alignment seq(m.g, trace);
+  seq.insert(seq.end(), states[0].seg.begin(), states[0].seg.end());
+  set<string> open;
+  uint32_t s = 0;     // deepest state reached
+  bool cached = true; // whether the trace is still following cached states
+
+  for (size_t nv=0; nv<trace.size(); ++nv) {
+    pair<uint64_t,string> key((uint64_t(s)<<32)|path[nv], labels[nv]);
+    if (cached) {
+      auto ch = children.find(key);
+      if (ch != children.end()) {
+        s = ch->second;
+        seq.insert(seq.end(), states[s].seg.begin(), states[s].seg.end());
+        ++hits;
+        continue;
+      }
+      open = states[s].open;
+    }
+
+    // not in cache, gap-fill this element from the current marking
+    size_t from = seq.size();
+    seq.push_back(label_move(m.g, labels[nv], nv));
+    fill_gaps(seq, from, open, m.g);
+    ++misses;
+
+    if (cached and states.size() < size_t(m.cfg.PREFIX_CACHE)) {
+      states.push_back(state());
+      states.back().open = open;
+      states.back().seg.assign(seq.begin()+from, seq.end());
+      s = states.size()-1;
+      children.insert(make_pair(key, s));
+    }
+    else cached = false;
+  }
+  if (cached) open = states[s].open;
+
+  size_t from = seq.size();
+  for (auto n : m.g.get_final_nodes())
+    seq.push_back(align_elem(align_elem::ANCHOR, m.g.get_index(n))); // final place, to anchor the sequence
+  fill_gaps(seq, from, open, m.g);
+
+  fitting = finish_alignment(seq, m.g);
+  return seq;
+}
+
+///////////////////////////////////////////////////////
+/// number of states kept
+
+size_t prefix_cache::size() const {
+  return states.size();
+}
+
+///////////////////////////////////////////////////////
+/// elements taken from the cache so far
+
+long prefix_cache::get_hits() const {
+  return hits;
+}
+
+///////////////////////////////////////////////////////
+/// elements gap-filled so far
+
+long prefix_cache::get_misses() const {
+  return misses;
+}
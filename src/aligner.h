@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __ALIGNER_H
+#define __ALIGNER_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <cstdint>
+
+#include "config.h"
+#include "graph.h"
+#include "bp.h"
+#include "relax.h"
+#include "alignment.h"
+
+////////////////////////////////////////////////////////////////
+///
+///  The class model holds everything needed to align traces
+///  against a process model: the unfolding with its paths, the
+///  behavioral profiles with and without loops, and the
+///  configuration parameters.  Once loaded, it is only read,
+///  so it can be shared by several aligners (and threads).
+///
+////////////////////////////////////////////////////////////////
+
+class model {
+
+ public:
+   /// alignment parameters
+   const config cfg;
+   /// model unfolding, with shortest paths loaded
+   graph g;
+   /// BP without loops (used to detect "real" parallels)
+   const behavioral_profile bptf;
+   /// BP with loops
+   const behavioral_profile bp;
+
+   /// Constructor, load model files with given prefix, and configuration file
+   model(const std::string &basename, const std::string &fconfig);
+   /// Constructor, load model files with given prefix, and use given configuration
+   model(const std::string &basename, const config &c);
+   /// Destructor
+   ~model();
+
+   /// check that all model files with given prefix and the configuration file can be read
+   static bool available(const std::string &basename, const std::string &fconfig);
+   /// check that the loaded files are consistent. Returns an error message (empty if they are)
+   std::string check() const;
+};
+
+
+////////////////////////////////////////////////////////////////
+///
+///  The class aligner aligns traces against a model, keeping
+///  the RL solver and reusable problem objects.  It uses no
+///  global state, so several aligners can run in parallel as
+///  long as each thread uses its own aligner.
+///
+////////////////////////////////////////////////////////////////
+
+class aligner {
+
+ private:
+   /// model to align with
+   const model &m;
+   /// RL solver, and problems reused for all traces
+   relax solver;
+   problem prob;
+   std::vector<problem> pool;
+   problem_batch batch;
+   /// RL iterations performed so far
+   long iterations;
+
+ public:
+   /// Constructor
+   aligner(const model &md);
+   /// Destructor
+   ~aligner();
+
+   /// align a trace. Returns the alignment, and whether it fits the model via 'fitting'
+   alignment align(const std::vector<std::string> &trace, bool &fitting);
+   /// align several traces, solving short ones together as a batch
+   std::vector<alignment> align(const std::vector<std::vector<std::string> > &traces, std::vector<bool> &fitting);
+   /// RL iterations performed so far
+   long get_iterations() const;
+};
+
+
+////////////////////////////////////////////////////////////////
+///
+///  The class online_case aligns an open case one event at a 
+///  time.  Each new event is added as a variable to a window
+///  problem and only its neighbourhood is re-relaxed.  When the
+///  window is full, its oldest events are committed: their labels
+///  are gap-filled from the current marking and will not change.
+///  So the cost of each event does not depend on the case length.
+///
+////////////////////////////////////////////////////////////////
+
+class online_case {
+
+ private:
+   /// model to align with
+   const model &m;
+   /// RL solver, and problem for the events in the window
+   relax solver;
+   problem prob;
+   /// events in the window (not committed yet)
+   std::vector<std::string> window;
+   /// window size and events kept when it slides
+   int size, overlap;
+   /// weights of the first events of the window, decided in the previous one
+   std::vector<std::vector<std::pair<std::string,double> > > pinned;
+   /// committed alignment, and marking reached after it
+   alignment done;
+   std::set<std::string> open;
+   /// RL iterations performed so far
+   long iterations;
+
+   /// commit the oldest events of the window and restart it with the remaining ones
+   void slide();
+   /// build the window problem from scratch, with pinned events fixed
+   void rebuild();
+
+ public:
+   /// Constructor
+   online_case(const model &md);
+   /// Destructor
+   ~online_case();
+
+   /// add next event of the case. Returns the provisional alignment of the not committed events
+   alignment append(const std::string &event);
+   /// finish the case. Returns the whole alignment, and whether it fits the model via 'fitting'
+   alignment close(bool &fitting);
+   /// RL iterations performed so far
+   long get_iterations() const;
+};
+
+
+////////////////////////////////////////////////////////////////
+///
+///  The class prefix_cache keeps the gap-filling results of
+///  already completed alignments, indexed by the log prefix trie
+///  (see log.h).  Gap filling an element only depends on the
+///  marking left by the elements before it, so variants sharing
+///  a prefix with the same labels can reuse the model moves and
+///  markings found for it, and only the part after the shared
+///  prefix needs find_path calls.
+///
+////////////////////////////////////////////////////////////////
+
+class prefix_cache {
+
+ private:
+   /// a gap-filling state: marking reached after an element, and the
+   /// elements it produced (model moves before it, and itself)
+   class state {
+     public:
+       std::set<std::string> open;
+       std::vector<align_elem> seg;
+   };
+
+   /// model to align with
+   const model &m;
+   /// states. State 0 is the marking after the initial anchors
+   std::vector<state> states;
+   /// child of each state, by trie node and label (key is state<<32|node)
+   std::map<std::pair<uint64_t,std::string>,uint32_t> children;
+   /// elements taken from the cache, and gap-filled
+   long hits, misses;
+
+ public:
+   /// Constructor, keeps at most m.cfg.PREFIX_CACHE states
+   prefix_cache(const model &md);
+   /// Destructor
+   ~prefix_cache();
+
+   /// build the final alignment from the best labels of a solved RL problem, given
+   /// the trie nodes of the trace prefixes (trace_log::get_path). Same result as complete_alignment
+   alignment complete(const std::vector<std::string> &trace, const std::vector<uint32_t> &path,
+                      const std::vector<std::string> &labels, bool &fitting);
+   /// number of states kept
+   size_t size() const;
+   /// elements taken from the cache, and gap-filled, so far
+   long get_hits() const;
+   long get_misses() const;
+};
+
+
+////////////////////////////////////////////////////////////////
+///
+///  The class labeling_structure keeps the labels and the
+///  constraints of the RL problem of a trace, without their
+///  compatibility values.  It is built once per trace, and then
+///  turned into the problems for several configurations, which
+///  only differ in compatibilities, initial weights, and maximum
+///  distance.  build_labeling_problem and add_constraints use it
+///  for a single configuration, so all paths create the same problems.
+///
+////////////////////////////////////////////////////////////////
+
+class labeling_structure {
+
+ private:
+   /// a pair of labels of two events: BP relation between them, whether
+   /// they are the same task, and their distance balance in each direction
+   /// (for progressive compatibilities; "real" parallels have balance 1)
+   class label_pair {
+     public:
+       int ev1, lb1, ev2, lb2;
+       behavioral_profile::relType relation;
+       bool same;
+       double balance12, balance21;
+   };
+   /// a dummy constraint: a label of an event and labels of its neighbours, 
+   /// and how much longer the path through the event is
+   class dummy_triple {
+     public:
+       int ev, lb, evL, lbL, evR, lbR;
+       double excess;
+   };
+
+   /// event names, and non-dummy labels of each event
+   std::vector<std::string> vars;
+   std::vector<std::vector<std::string>> labels;
+   /// label pairs of events at most max_dist apart, in the order constraints are added
+   std::vector<label_pair> pairs;
+   std::vector<dummy_triple> triples;
+
+   /// find the constrained pairs and dummy triples involving events from 'from' onwards
+   void find_constraints(const model &m, int max_dist, bool balances, bool dummies, int from);
+   /// add the constraints for given configuration to a problem or problem batch
+   template <class T> void add_constraints(T &target, const config &cfg) const;
+
+ public:
+   /// Constructor, for a trace. Pairs up to max_dist events apart are kept (0 = all).
+   /// Distance balances and dummy triples are only computed if needed (for progressive 
+   /// compatibilities, and for dummy compatibility)
+   labeling_structure(const std::vector<std::string> &trace, const model &m, int max_dist, 
+                      bool balances, bool dummies);
+   /// Constructor, for a trace aligned with the model configuration
+   labeling_structure(const std::vector<std::string> &trace, const model &m);
+   /// Constructor, for the labels of an existing problem of the trace, keeping only
+   /// constraints involving events from 'from' onwards, for the model configuration
+   labeling_structure(const problem &prob, const std::vector<std::string> &trace, const model &m, int from);
+   /// Destructor
+   ~labeling_structure();
+
+   /// fill the problem for the trace with given configuration. Its MAX_DIST must
+   /// not exceed the one the structure was built with, and it may only use dummy
+   /// compatibility if the structure has dummy triples
+   void build_problem(problem &prob, const config &cfg) const;
+   /// reset the problem and add only its variables and labels
+   void build_labels(problem &prob, const config &cfg) const;
+   /// add the constraints of a problem filled by build_labels, after packing it
+   /// with problem_batch::add_labels, directly into the batch tables
+   void build_constraints(problem_batch &batch, const config &cfg) const;
+   /// add the constraints to a problem filled by build_labels
+   void build_constraints(problem &prob, const config &cfg) const;
+};
+
+
+/// add possible labels of the trace events (from 'from' onwards) as variables of the problem
+void add_variable_labels(problem &prob, const std::vector<std::string> &trace, const graph &g,
+                         const config &cfg, size_t from=0);
+/// add BP constraints between labels, for events from 'from' onwards
+void add_constraints(problem &prob, const std::vector<std::string> &trace, const model &m, int from=0);
+/// fill a constraint satisfaction problem for the trace
+void build_labeling_problem(problem &prob, const std::vector<std::string> &trace, const model &m);
+/// get the name of the best label for each variable of a solved RL problem
+std::vector<std::string> best_labels(const problem &prob, int nvars);
+/// solve the RL problem for a long trace using overlapping windows. If given,
+/// the constraints of all windows are added to 'constraints'
+std::vector<std::string> solve_windowed(const std::vector<std::string> &trace, const model &m,
+                                        const relax &solver, problem &prob, long &iters,
+                                        long *constraints=NULL);
+/// move for the event at given position with given label (a log move for the dummy label)
+align_elem label_move(const graph &g, const std::string &label, uint32_t ev);
+/// fill the gaps of an alignment from position 'from' with model moves, updating the marking
+void fill_gaps(alignment &seq, size_t from, std::set<std::string> &open, const graph &g);
+/// remove anchors from a gap-filled alignment, purge it, and check fitness
+bool finish_alignment(alignment &seq, const graph &g);
+/// try to align the trace by direct token replay on the model
+bool replay_alignment(const std::vector<std::string> &trace, const model &m, alignment &seq);
+/// build the final alignment from the best labels of a solved RL problem
+alignment complete_alignment(const std::vector<std::string> &trace, const std::vector<std::string> &labels,
+                             const model &m, bool &fitting);
+/// name of the fitness status of an alignment, as printed in results
+std::string fitting_name(bool fitting);
+
+#endif
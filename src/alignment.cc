@@ -24,51 +24,92 @@
 //
 ////////////////////////////////////////////////////////////////
 
-
 #include "alignment.h"
+#include "graph.h"
 
 using namespace std;
 
-align_elem::align_elem(const string &i, const string &n, const string &t) : id(i), name(n), type(t) {}
+/// printed form of each move type
+static const string TYPE_NAME[] = {"[L]", "[L/M]", "[M-REAL]", "[ANCHOR]"};
+/// name printed for anchors
+static const string ANCHOR_NAME = "^";
 
-align_elem::~align_elem() {}
+static_assert(sizeof(align_elem)==8, "alignment moves are expected to take 8 bytes");
 
-string align_elem::dump(bool show_id) const {
-  return this->type + this->name + (show_id ? "("+this->id+")" : "");
-}
+const uint32_t align_elem::NONE;
+const uint32_t align_elem::NO_EVENT;
+
+align_elem::align_elem(move_type t, uint32_t n, uint32_t ev) : node(n), event(ev), type(t) {}
+
+align_elem::~align_elem() {}
 
 bool align_elem::operator<(const align_elem &e) const {
-  bool b;
-  if (this->type < e.type) b = true;
-  else if (this->type == e.type and this->name < e.name) b = true;
-  else if (this->type == e.type and this->name == e.name and this->id < e.id) b = true;
-  else b = false;
-  return b;
+  if (this->type != e.type) return this->type < e.type;
+  if (this->node != e.node) return this->node < e.node;
+  return this->event < e.event;
 }
 
 bool align_elem::operator==(const align_elem &e) const {
-  return (this->type == e.type and this->name == e.name and this->id == e.id);
+  return (this->type == e.type and this->node == e.node and this->event == e.event);
 }
 
+
+alignment::alignment() : g(NULL) {}
+
+alignment::alignment(const graph &gr) : g(&gr) {}
+
+alignment::alignment(const graph &gr, const vector<string> &evs) : g(&gr), events(evs) {}
+
+uint32_t alignment::add_event(const string &ev) {
+  events.push_back(ev);
+  return events.size()-1;
+}
+
+/// task name of a move: the log event for log and sync moves, the transition name for model moves
+
+const string &alignment::name(const align_elem &e) const {
+  if (e.type == align_elem::ANCHOR) return ANCHOR_NAME;
+  if (e.event != align_elem::NO_EVENT) return events[e.event];
+  return g->get_node(e.node).name;
+}
+
+/// node id of a move (graph::DUMMY for log moves with no model task)
+
+const string &alignment::id(const align_elem &e) const {
+  if (e.node == align_elem::NONE) return graph::DUMMY;
+  return g->get_node(e.node).id;
+}
+
+string alignment::dump(const align_elem &e, bool show_id) const {
+  return TYPE_NAME[e.type] + name(e) + (show_id ? "("+id(e)+")" : "");
+}
+
+/// merge a log move followed by a model move of the same task into a sync move
+
 void alignment::purge() {
-  auto prev = this->begin();
-  auto ev = prev; ++ev;
-  while (ev!=this->end()) {
-    if (prev->type=="[L]" and ev->type=="[M-REAL]" and prev->name==ev->name) {
-      ev->type = "[L/M]";
-      this->erase(prev);
+  size_t w = 0;
+  for (size_t r=0; r<size(); ++r) {
+    align_elem ev = (*this)[r];
+    if (w>0) {
+      const align_elem &prev = (*this)[w-1];
+      if (prev.type==align_elem::LOG and ev.type==align_elem::MODEL and name(prev)==name(ev)) {
+        ev.type = align_elem::SYNC;
+        ev.event = prev.event;
+        --w;  // remove the log move
+      }
     }
-
-    prev = ev;
-    ++ev;
+    (*this)[w++] = ev;
   }
+  erase(begin()+w, end());
 }
 
 string alignment::dump(bool id) const {
   string s;
-  for (auto e : *this) 
-    s += "|" + e.dump(id);
-  return (s.length()>1 ? s.substr(1) : s);
+  for (auto &e : *this) {
+    if (not s.empty()) s += "|";
+    s += TYPE_NAME[e.type];
+    s += name(e);
+    if (id) s += "(" + this->id(e) + ")";
+  }
+  return s;
 }
-
-
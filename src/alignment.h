@@ -24,30 +24,73 @@
 //
 ////////////////////////////////////////////////////////////////
 
+
 #ifndef _ALIGNMENT_H
 #define _ALIGNMENT_H
 
-#include <list>
+#include <vector>
 #include <string>
+#include <cstdint>
+
+class graph;
+
+////////////////////////////////////////////////////////////////
+///
+///  An alignment element is an 8-byte move: its type, the index
+///  of its model node (see graph::get_index), and the position
+///  of its log event in the events of the alignment.  Names are
+///  only resolved (through the alignment) when it is printed.
+///
+////////////////////////////////////////////////////////////////
 
 class align_elem {
  public:
-  std::string id;    // node id
-  std::string name;  // task name
-  std::string type;  // [L], [L/M], or [M-REAL]
+  typedef enum {LOG, SYNC, MODEL, ANCHOR} move_type;  // [L], [L/M], [M-REAL], [ANCHOR]
+  /// node index for log moves with no model task, and event position for moves with no log event
+  static const uint32_t NONE = 0xffffffff;
+  static const uint32_t NO_EVENT = (1u<<30)-1;
+
+  uint32_t node;       // model node index (transition, or place for anchors)
+  uint32_t event : 30; // position of the log event, NO_EVENT for model moves and anchors
+  uint32_t type : 2;   // move_type
 
-  align_elem(const std::string &i, const std::string &n, const std::string &t);
+  align_elem(move_type t, uint32_t n, uint32_t ev=NO_EVENT);
   ~align_elem();
 
-  std::string dump(bool id=false) const;
   bool operator<(const align_elem &e) const;
   bool operator==(const align_elem &e) const;
 };
 
 
-class alignment : public std::list<align_elem> {
+////////////////////////////////////////////////////////////////
+///
+///  An alignment is a sequence of moves, with the log events
+///  and the model they refer to.
+///
+////////////////////////////////////////////////////////////////
+
+class alignment : public std::vector<align_elem> {
+ private:
+  /// model the node indices refer to
+  const graph *g;
+  /// log events the moves refer to
+  std::vector<std::string> events;
+
  public:
+  alignment();
+  alignment(const graph &gr);
+  alignment(const graph &gr, const std::vector<std::string> &evs);
+
+  /// add a log event, returning its position
+  uint32_t add_event(const std::string &ev);
+  /// task name, and node id, of a move
+  const std::string &name(const align_elem &e) const;
+  const std::string &id(const align_elem &e) const;
+
+  /// print a move, or the whole alignment, as [type]name (plus (id) if requested)
+  std::string dump(const align_elem &e, bool id=false) const;
   std::string dump(bool id=false) const;
+  /// merge log moves followed by a model move of the same task into sync moves
   void purge();
 };
 
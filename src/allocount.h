@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __ALLOCOUNT_H
+#define __ALLOCOUNT_H
+
+////////////////////////////////////////////////////////////////
+///
+///  Allocation counting: allocount.o replaces the global operator
+///  new and delete, so that every allocation of a program linked
+///  with it (including those made in the library) is counted.
+///  It is linked only into the programs that report allocations,
+///  and is not part of libbpm.a.
+///
+////////////////////////////////////////////////////////////////
+
+/// number of allocations made so far by the program
+long allocation_count();
+
+#endif
@@ -28,6 +28,7 @@
 #include <iostream>
 #include <fstream>
 #include "bp.h"
+#include "timeline.h"
 
 using namespace std;
 
@@ -41,6 +42,7 @@ behavioral_profile::behavioral_profile() {}
 
 behavioral_profile::behavioral_profile(const std::string &bpfile) {
   
+  timeline::scope ts("load bp");
   ifstream fin;
   fin.open(bpfile);
   string n1,n2,rel;
@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "cache.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "CACHE"
+#define MOD_TRACECODE CACHE_TRACE
+
+using namespace std;
+
+/// 64-bit FNV-1a hash of a string, continuing from given hash value
+
+uint64_t result_cache::hash(const string &s, uint64_t h) {
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/// hash of a file contents, continuing from given hash value
+
+uint64_t result_cache::hash_file(const string &fname, uint64_t h) {
+  ifstream f(fname, ios::binary);
+  if (f.fail()) { ERROR_CRASH("Error opening file '" << fname << "'"); }
+
+  char buff[65536];
+  while (f.read(buff, sizeof(buff)) or f.gcount()>0) 
+    h = hash(string(buff, f.gcount()), h);
+  return h;
+}
+
+
+/// escape backslashes, tabs and line breaks in a record field,
+/// and also '|' if it separates values in the field
+
+static string escape(const string &s, bool bars) {
+  string r;
+  r.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+      case '\\': r += "\\\\"; break;
+      case '|':  r += (bars ? "\\p" : "|"); break;
+      case '\t': r += "\\t"; break;
+      case '\n': r += "\\n"; break;
+      case '\r': r += "\\r"; break;
+      default:   r += c;
+    }
+  }
+  return r;
+}
+
+/// undo the escaping of a record field
+
+static string unescape(const string &s) {
+  string r;
+  r.reserve(s.size());
+  for (size_t i=0; i<s.size(); ++i) {
+    if (s[i]!='\\' or i+1==s.size()) { r += s[i]; continue; }
+    switch (s[++i]) {
+      case 'p': r += '|'; break;
+      case 't': r += '\t'; break;
+      case 'n': r += '\n'; break;
+      case 'r': r += '\r'; break;
+      default:  r += s[i];
+    }
+  }
+  return r;
+}
+
+/// events of a variant as stored in records: escaped, and separated by '|'
+
+static string event_field(const vector<string> &trace) {
+  string r;
+  for (auto &e : trace) r += escape(e, true) + "|";
+  return r;
+}
+
+
+/// Constructor, load index of existing cache file (if any) and
+/// open it for appending new records
+
+result_cache::result_cache(const string &fname, uint64_t ctx) : fdata(fname), findex(fname+".idx"), context(ctx) {
+
+  // load index entries. A torn last entry (interrupted run) is dropped from 
+  // the file, so that new entries are appended at the right place
+  uint64_t last = 0;
+  bool indexed = false;
+  ifstream idx(findex, ios::binary);
+  uint64_t entry[2];
+  long entries = 0;
+  while (idx.read((char*)entry, sizeof(entry))) {
+    index[entry[0]] = entry[1];
+    if (not indexed or entry[1]>last) last = entry[1];
+    indexed = true;
+    ++entries;
+  }
+  bool torn = (idx.gcount()>0);
+  idx.close();
+  if (torn) {
+    WARNING("Dropping incomplete last entry of cache index " << findex);
+    if (truncate(findex.c_str(), entries*sizeof(entry))!=0) { ERROR_CRASH("Error truncating file '" << findex << "'"); }
+  }
+
+  index_out.open(findex, ios::binary|ios::app);
+  if (index_out.fail()) { ERROR_CRASH("Error opening file '" << findex << "'"); }
+
+  // records appended after the last indexed one (e.g. missing index) are indexed now
+  scan_data(indexed ? last : 0, indexed);
+
+  data_out.open(fdata, ios::binary|ios::app);
+  if (data_out.fail()) { ERROR_CRASH("Error opening file '" << fdata << "'"); }
+  data_out.seekp(0, ios::end);
+
+  data_in.open(fdata, ios::binary);
+  if (data_in.fail()) { ERROR_CRASH("Error opening file '" << fdata << "'"); }
+
+  TRACE(1, "Result cache " << fdata << " loaded with " << index.size() << " records");
+}
+
+/// Destructor
+
+result_cache::~result_cache() {}
+
+
+/// compute the key of a variant: context and event sequence
+
+uint64_t result_cache::key(const vector<string> &trace) const {
+  return hash(event_field(trace), context);
+}
+
+
+/// add to the index records in the data file starting at given offset.
+/// If 'skip' is set, the record at that offset is already indexed.
+
+void result_cache::scan_data(uint64_t from, bool skip) {
+
+  ifstream f(fdata, ios::binary);
+  if (f.fail()) return;
+  f.seekg(from);
+
+  string line;
+  uint64_t pos = from;
+  if (skip and getline(f,line)) pos += line.size()+1;
+  
+  int added = 0;
+  while (getline(f,line)) {
+    if (f.eof()) {
+      // torn last record, terminate it so new records start on a fresh line
+      ofstream(fdata, ios::binary|ios::app) << "\n";
+      break;
+    }
+    
+    uint64_t k;
+    try { k = std::stoull(line.substr(0,line.find('\t')), NULL, 16); }
+    catch (std::exception &e) {
+      WARNING("Corrupted record at offset " << pos << " of cache " << fdata << ", the records after it are not indexed");
+      break;
+    }
+    index[k] = pos;
+    index_out.write((const char*)&k, sizeof(k));
+    index_out.write((const char*)&pos, sizeof(pos));
+    ++added;
+    pos += line.size()+1;
+  }
+  index_out.flush();
+
+  if (added>0) { TRACE(2, "  indexed " << added << " records not found in " << findex); }
+}
+
+
+/// number of records in the cache (for any context)
+
+size_t result_cache::size() const {
+  return index.size();
+}
+
+
+/// look up an alignment for the variant.  Returns false if not cached.
+
+bool result_cache::lookup(const vector<string> &trace, string &solution, string &fitting) const {
+
+  auto p = index.find(key(trace));
+  if (p==index.end()) return false;
+
+  // records may have been appended since last read, so clear EOF before seeking
+  data_in.clear();
+  data_in.seekg(p->second);
+  string line;
+  if (not getline(data_in,line)) return false;
+
+  // record is: key, fitting, events, alignment.  Check events to rule out hash collisions
+  istringstream sin(line);
+  string k, events;
+  getline(sin,k,'\t'); getline(sin,fitting,'\t'); getline(sin,events,'\t'); getline(sin,solution);
+  solution = unescape(solution);
+
+  return events==event_field(trace);
+}
+
+
+/// add alignment for a variant to the cache
+
+void result_cache::store(const vector<string> &trace, const string &solution, const string &fitting) {
+
+  uint64_t k = key(trace);
+  uint64_t pos = data_out.tellp();
+
+  ostringstream rec;
+  rec << hex << k << "\t" << fitting << "\t" << event_field(trace) << "\t" << escape(solution, false) << "\n";
+  data_out << rec.str();
+  data_out.flush();
+
+  index_out.write((const char*)&k, sizeof(k));
+  index_out.write((const char*)&pos, sizeof(pos));
+  index_out.flush();
+
+  index[k] = pos;
+}
@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class result_cache keeps alignments computed in previous
+///  runs in an append-only data file, so that variants already
+///  aligned with the same model and configuration are not solved
+///  again.  Each result is keyed by a hash of the run context
+///  (model bundle and configuration) and the variant events.
+///  An index file (data file name + ".idx") holds the key and
+///  file offset of each record, to avoid scanning the data on load.
+///  Record fields are escaped, so event names and alignments may
+///  contain any character.
+///
+////////////////////////////////////////////////////////////////
+
+class result_cache {
+
+ public:
+   /// 64-bit FNV-1a hash of a string, continuing from given hash value
+   static uint64_t hash(const std::string &s, uint64_t h=0xcbf29ce484222325ULL);
+   /// hash of a file contents, continuing from given hash value
+   static uint64_t hash_file(const std::string &fname, uint64_t h=0xcbf29ce484222325ULL);
+
+ private:
+   /// data and index file names
+   std::string fdata;
+   std::string findex;
+   /// hash of the run context, included in all keys
+   uint64_t context;
+   /// offset of each record in the data file, by key
+   std::unordered_map<uint64_t,uint64_t> index;
+   /// files open for appending new records
+   std::ofstream data_out;
+   std::ofstream index_out;
+   /// data file open for reading records on lookup
+   mutable std::ifstream data_in;
+
+   /// compute the key of a variant
+   uint64_t key(const std::vector<std::string> &trace) const;
+   /// add to the index records in the data file after given offset
+   void scan_data(uint64_t from, bool skip);
+
+ public:
+   /// Constructor, open (or create) cache file for given run context
+   result_cache(const std::string &fname, uint64_t ctx);
+   /// Destructor
+   ~result_cache();
+
+   /// number of records in the cache (for any context)
+   size_t size() const;
+   /// look up an alignment for the variant.  Returns false if not cached.
+   /// Not thread-safe: it shares the open data file among calls
+   bool lookup(const std::vector<std::string> &trace, std::string &solution, std::string &fitting) const;
+   /// add alignment for a variant to the cache
+   void store(const std::vector<std::string> &trace, const std::string &solution, const std::string &fitting);
+};
+
+#endif
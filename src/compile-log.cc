@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdlib>
+
+#include "log.h"
+#include "traces.h"
+#define MOD_TRACENAME "COMPILE_LOG"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  if (argc<3) {
+    ERROR_CRASH("Usage " << argv[0] << " traces binlog [threads [tracingoptions]]\n         Converts a .xes log (plain or compressed) to binary format, which align loads much faster.\n         e.g.: "<<argv[0] << " logsdir/M1.xes logsdir/M1.rlog");
+  }
+
+  string ftrace(argv[1]);
+  string fout(argv[2]);
+  int threads = (argc>3 ? atoi(argv[3]) : 0);
+
+  traces::set_tracing(argc>4 ? string(argv[4]) : "");
+
+  TRACE(1, "Loading trace file " << ftrace);
+  trace_log log;
+  log.load(ftrace, threads);
+  TRACE(1, "Loaded " << log.num_cases() << " traces, " << log.num_variants() << " variants...");
+
+  log.save_binary(fout);
+  cerr << ftrace << ": " << log.num_cases() << " cases, " << log.num_variants() << " variants, "
+       << log.num_activities() << " activities saved to " << fout << endl;
+}
@@ -53,41 +53,19 @@ config::config(const string &fconfig) {
   string line;
   while (getline(scfg,line)) {
     if (line.empty() or line[0]=='#') continue;
-    
-    istringstream sin; sin.str(line);
-    string key; string val;
-    sin >> key >> val;      
-    
-    if (key == "DummyInitialWeight") DUMMY_INITIAL_WEIGHT=std::stod(val);
-    else if (key == "DummyCompatibility") DUMMY_COMPAT=std::stod(val);
-    else if (key == "ExclusiveCompatibility") EXCLUSIVE_COMPAT=std::stod(val);
-    else if (key == "CrossCompatibility") CROSS_COMPAT=std::stod(val);
-    else if (key == "RepeatCompatibility") REPEAT_COMPAT=std::stod(val);
-    else if (key == "MaximumDistance") MAX_DIST = std::stoi(val);
-    else if (key == "OrderCompatibility") {
-      ORDER_COMPAT=std::stod(val);
-      string type;
-      sin >> type;
-      ORDER_PROGRESSIVE = (type=="1/dist");
+    if (not set(line)) {
+      istringstream sin(line);
+      string key;
+      sin >> key;
+      WARNING("Ignoring unexpected key '" << key << "' in file '" << fconfig << "'.");
     }
-    else if (key == "ParallelCompatibility") {
-      PARALLEL_COMPAT=std::stod(val);
-      string type;
-      sin >> type;
-      PARALLEL_PROGRESSIVE = (type=="1/dist");
-    }
- 
-    else if (key == "RL_MaxIter") MAX_ITER = std::stoi(val);
-    else if (key == "RL_ScaleFactor") SCALE_FACTOR = std::stod(val);
-    else if (key == "RL_Epsilon") EPSILON = std::stod(val);
-
-    else if (key == "AddIFS") ADD_IFS = (val!="false");
-    else if (key == "AddLOOPS") ADD_LOOPS = (val!="false");
-
-    else { WARNING("Ignoring unexpected key '" << key << "' in file '" << fconfig << "'."); }     
   }
 
   TRACE(1,"Read Configuration");
+  TRACE(2,"  RL_PruneThreshold = " << PRUNE_THRESHOLD);
+  TRACE(2,"  BatchSize = " << BATCH_SIZE);
+  TRACE(2,"  WindowSize = " << WINDOW_SIZE << " overlap:" << WINDOW_OVERLAP);
+  TRACE(2,"  WarmStart = " << WARM_START << " compare:" << WARM_START_COMPARE << " blend:" << WARM_START_BLEND);
   TRACE(2,"  DummyInitialWeight = " << DUMMY_INITIAL_WEIGHT);
   TRACE(2,"  DummyCompatibility = " << DUMMY_COMPAT);
   TRACE(2,"  ExclusiveCompatibility = " << EXCLUSIVE_COMPAT);
@@ -96,6 +74,14 @@ config::config(const string &fconfig) {
   TRACE(2,"  OrderCompatibility = " << ORDER_COMPAT << " progressive:" << ORDER_PROGRESSIVE);
   TRACE(2,"  ParallelCompatibility = " << PARALLEL_COMPAT << " progressive:" << PARALLEL_PROGRESSIVE);
   TRACE(2,"  MaximumDistance = " << MAX_DIST);
+  TRACE(2,"  FastReplay = " << FAST_REPLAY << " limit:" << FAST_REPLAY_LIMIT);
+  TRACE(2,"  ResultCache = " << RESULT_CACHE);
+  TRACE(2,"  PrefixCache = " << PREFIX_CACHE);
+  TRACE(2,"  OutputFormat = " << OUTPUT_FORMAT);
+  TRACE(2,"  LoadThreads = " << LOAD_THREADS);
+  TRACE(2,"  Statistics = " << STATISTICS);
+  TRACE(2,"  PerfCounters = " << PERF_COUNTERS << " variants:" << PERF_COUNTERS_VARIANTS);
+  TRACE(2,"  Timeline = " << TIMELINE);
   TRACE(2,"  AddIFS = " << ADD_IFS);
   TRACE(2,"  AddLOOPS = " << ADD_LOOPS);
 
@@ -104,5 +90,86 @@ config::config(const string &fconfig) {
 
 
 
+///////////////////////////////////////////////////////
+/// set a parameter from a configuration file line ("Key value").
+/// Returns false if the key is unknown
+
+bool config::set(const string &line) {
+
+  istringstream sin; sin.str(line);
+  string key; string val;
+  sin >> key >> val;      
+  
+  if (key == "DummyInitialWeight") DUMMY_INITIAL_WEIGHT=std::stod(val);
+  else if (key == "DummyCompatibility") DUMMY_COMPAT=std::stod(val);
+  else if (key == "ExclusiveCompatibility") EXCLUSIVE_COMPAT=std::stod(val);
+  else if (key == "CrossCompatibility") CROSS_COMPAT=std::stod(val);
+  else if (key == "RepeatCompatibility") REPEAT_COMPAT=std::stod(val);
+  else if (key == "MaximumDistance") MAX_DIST = std::stoi(val);
+  else if (key == "OrderCompatibility") {
+    ORDER_COMPAT=std::stod(val);
+    string type;
+    sin >> type;
+    ORDER_PROGRESSIVE = (type=="1/dist");
+  }
+  else if (key == "ParallelCompatibility") {
+    PARALLEL_COMPAT=std::stod(val);
+    string type;
+    sin >> type;
+    PARALLEL_PROGRESSIVE = (type=="1/dist");
+  }
+ 
+  else if (key == "RL_MaxIter") MAX_ITER = std::stoi(val);
+  else if (key == "RL_ScaleFactor") SCALE_FACTOR = std::stod(val);
+  else if (key == "RL_Epsilon") EPSILON = std::stod(val);
+  else if (key == "RL_PruneThreshold") PRUNE_THRESHOLD = std::stod(val);
+  else if (key == "WarmStart") {
+    WARM_START = (val!="false");
+    WARM_START_COMPARE = (val=="compare");
+  }
+  else if (key == "WarmStartBlend") WARM_START_BLEND = std::stod(val);
+  else if (key == "BatchSize") BATCH_SIZE = std::stoi(val);
+  else if (key == "WindowSize") WINDOW_SIZE = std::stoi(val);
+  else if (key == "WindowOverlap") WINDOW_OVERLAP = std::stoi(val);
+
+  else if (key == "FastReplay") FAST_REPLAY = (val!="false");
+  else if (key == "FastReplayLimit") FAST_REPLAY_LIMIT = std::stoi(val);
+  else if (key == "ResultCache") RESULT_CACHE = val;
+  else if (key == "PrefixCache") PREFIX_CACHE = std::stoi(val);
+  else if (key == "OutputFormat") OUTPUT_FORMAT = val;
+  else if (key == "LoadThreads") LOAD_THREADS = std::stoi(val);
+  else if (key == "Statistics") STATISTICS = (val!="false");
+  else if (key == "PerfCounters") {
+    PERF_COUNTERS = (val!="false");
+    PERF_COUNTERS_VARIANTS = (val=="variants");
+  }
+  else if (key == "Timeline") TIMELINE = val;
+
+  else if (key == "AddIFS") ADD_IFS = (val!="false");
+  else if (key == "AddLOOPS") ADD_LOOPS = (val!="false");
+
+  else return false;
+  return true;
+}
+
 config::~config() {}
 
+
+///////////////////////////////////////////////////////
+/// parameters that affect alignment results, as a string.
+/// Options that only affect speed or output (e.g. batching, 
+/// statistics, cache file) are not included. The results version
+/// comes first, so a new version does not reuse old cached results.
+
+string config::signature() const {
+  ostringstream sout;
+  sout.precision(17);
+  sout << "v" << RESULTS_VERSION << " " << MAX_ITER << " " << SCALE_FACTOR << " " << EPSILON << " " << PRUNE_THRESHOLD << " "
+       << WARM_START << " " << WARM_START_BLEND << " " << WINDOW_SIZE << " " << WINDOW_OVERLAP << " "
+       << DUMMY_INITIAL_WEIGHT << " " << DUMMY_COMPAT << " " << EXCLUSIVE_COMPAT << " " << CROSS_COMPAT << " "
+       << ORDER_COMPAT << " " << ORDER_PROGRESSIVE << " " << PARALLEL_COMPAT << " " << PARALLEL_PROGRESSIVE << " "
+       << REPEAT_COMPAT << " " << MAX_DIST << " " << FAST_REPLAY << " " << FAST_REPLAY_LIMIT << " "
+       << ADD_IFS << " " << ADD_LOOPS;
+  return sout.str();
+}
+
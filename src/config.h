@@ -42,6 +42,18 @@ class config {
     int MAX_ITER=500;
     double SCALE_FACTOR=100.0;
     double EPSILON=0.001;
+    /// labels with weight below this floor are pruned during RL (0 = no pruning)
+    double PRUNE_THRESHOLD=0.0;
+    /// seed RL weights from solved traces sharing a prefix (and compare with cold start)
+    bool WARM_START=false;
+    bool WARM_START_COMPARE=false;
+    double WARM_START_BLEND=0.1;
+    /// number of short traces solved together by the batched RL solver (0 or 1 = no batching)
+    int BATCH_SIZE=0;
+    /// traces longer than WINDOW_SIZE events are solved by overlapping windows (0 = never)
+    int WINDOW_SIZE=0;
+    /// events shared by consecutive windows (0 = use MAX_DIST)
+    int WINDOW_OVERLAP=0;
     
     double DUMMY_INITIAL_WEIGHT = +0.1;
     /// Constraint default compatibilities and other stuff
@@ -55,9 +67,38 @@ class config {
     double REPEAT_COMPAT = -5.0;
     int MAX_DIST = 3;
     
+    /// try direct token replay before RL, and maximum number of firings it may explore
+    bool FAST_REPLAY=false;
+    int FAST_REPLAY_LIMIT=1000;
+    /// file where alignments are kept across runs (empty = no result cache)
+    std::string RESULT_CACHE;
+    /// maximum number of gap-filling states kept for shared trace prefixes (0 = no prefix cache)
+    int PREFIX_CACHE = 0;
+    /// format of alignment results: text, compact, or binary (see output.h)
+    std::string OUTPUT_FORMAT = "text";
+    /// threads used to parse the log file (0 = one per core)
+    int LOAD_THREADS = 1;
+    /// print run statistics to stderr when alignment finishes
+    bool STATISTICS = false;
+    /// measure hardware performance counters of each phase (and report them for each variant)
+    bool PERF_COUNTERS = false;
+    bool PERF_COUNTERS_VARIANTS = false;
+    /// file where a timeline of the run is written in Chrome trace format (empty = none)
+    std::string TIMELINE;
+
     // options about unfolding BP
     bool ADD_IFS = false;
     bool ADD_LOOPS = false;
+
+    /// set a parameter from a configuration file line ("Key value"). Returns false if the key is unknown
+    bool set(const std::string &line);
+
+    /// version of the alignment code results, included in the signature. Increase it
+    /// whenever a change in the solver or in the cached record format may change results
+    static const int RESULTS_VERSION = 2;
+
+    /// parameters that affect alignment results, as a string (used to key cached results)
+    std::string signature() const;
     
 };
 
@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __FLOYD_H
+#define __FLOYD_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include "graph.h"
+
+////////////////////////////////////////////////////////////////
+///
+///  Shortest paths between all pairs of nodes of a model, with a
+///  Floyd variant that does not break parallel blocks: a path
+///  entering a parallel split must run the whole block up to its
+///  matching join.  Paths are kept by "i:::j" key.  Used by the
+///  paths program to precompute the .path files of a model.
+///
+////////////////////////////////////////////////////////////////
+
+/// init path matrix with direct edges, and paths from each parallel split to its matching join
+void init_path_matrix(graph &g, std::map<std::string,std::list<std::string>> &paths, std::map<std::string,std::string> &parallels);
+/// compute all shortest paths using Floyd variant
+void floyd(const graph &g, std::map<std::string,std::list<std::string>> &paths, const std::map<std::string,std::string> &parallels);
+/// set paths from each node to itself to the shortest loop through it, if any
+void fix_self_paths(const graph &g, std::map<std::string,std::list<std::string>> &paths, const std::map<std::string,std::string> &parallels);
+
+#endif
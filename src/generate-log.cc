@@ -0,0 +1,295 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <zlib.h>
+
+#include "graph.h"
+#include "log.h"
+#include "traces.h"
+#define MOD_TRACENAME "GENERATE_LOG"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+///////////////////////////////////////////////////////
+/// Generation parameters
+
+class parameters {
+ public:
+  /// number of cases, and of distinct playouts they are drawn from (0 = one per case)
+  long cases = 1000;
+  long variants = 0;
+  /// Zipf exponent of the frequency of playouts (0 = all equally likely)
+  double skew = 1.0;
+  /// range of trace lengths (0 = no limit), playouts tried to reach it, and maximum firings per playout
+  size_t min_length = 0, max_length = 0;
+  int attempts = 20;
+  size_t limit = 10000;
+  /// probability of each event being swapped with the next, preceded by a random event, or deleted
+  double swaps = 0, insertions = 0, deletions = 0;
+  /// log whose activities are the visible tasks (empty = tasks not named "tau...")
+  string reference;
+  unsigned seed = 1;
+};
+
+///////////////////////////////////////////////////////
+/// play out the net from its initial marking, firing random enabled
+/// transitions until it reaches a final marking (or the firing limit). 
+/// Returns the names of the visible transitions fired.
+
+vector<string> play_out(const graph &g, const set<string> &visible, size_t limit, mt19937 &rng) {
+  vector<string> trace;
+  set<string> open = g.get_initial_nodes();
+  set<string> ptr = g.possible_transitions(open);
+  for (size_t n=0; n<limit and not ptr.empty() and not g.is_final(open); ++n) {
+    auto t = ptr.begin();
+    advance(t, uniform_int_distribution<size_t>(0, ptr.size()-1)(rng));
+    const string &name = g.get_node(*t).name;
+    if (visible.count(name)>0) trace.push_back(name);
+    open = g.fire_transition(open, *t);
+    ptr = g.possible_transitions(open);
+  }
+  return trace;
+}
+
+///////////////////////////////////////////////////////
+/// play out the net several times, and keep the first playout in the 
+/// length range, or the closest one to it
+
+vector<string> random_trace(const graph &g, const set<string> &visible, const parameters &par, mt19937 &rng) {
+  vector<string> best;
+  size_t best_miss = 0;
+  for (int a=0; a<par.attempts; ++a) {
+    vector<string> trace = play_out(g, visible, par.limit, rng);
+    size_t n = trace.size();
+    size_t miss = (n<par.min_length ? par.min_length-n : par.max_length>0 and n>par.max_length ? n-par.max_length : 0);
+    if (a==0 or miss<best_miss) {
+      best.swap(trace);
+      best_miss = miss;
+    }
+    if (best_miss==0) break;
+  }
+  return best;
+}
+
+///////////////////////////////////////////////////////
+/// add noise to a trace: swapped, inserted and deleted events
+
+vector<string> add_noise(const vector<string> &trace, const vector<string> &activities, const parameters &par, mt19937 &rng) {
+  if (par.swaps==0 and par.insertions==0 and par.deletions==0) return trace;
+
+  uniform_real_distribution<double> p(0,1);
+  uniform_int_distribution<size_t> act(0, activities.size()-1);
+  vector<string> noisy;
+  for (size_t i=0; i<trace.size(); ++i) {
+    if (p(rng)<par.insertions) noisy.push_back(activities[act(rng)]);
+    if (p(rng)<par.deletions) continue;
+    noisy.push_back(trace[i]);
+  }
+  for (size_t i=0; i+1<noisy.size(); ++i) 
+    if (p(rng)<par.swaps) std::swap(noisy[i], noisy[i+1]);
+  return noisy;
+}
+
+///////////////////////////////////////////////////////
+/// Writer of XES files, plain or gzip compressed (if the name ends in .gz)
+
+class xes_writer {
+ private:
+  FILE *f;
+  gzFile gz;
+  string buffer;
+
+  void flush() {
+    if (gz!=NULL) gzwrite(gz, buffer.data(), buffer.size());
+    else fwrite(buffer.data(), 1, buffer.size(), f);
+    buffer.clear();
+  }
+
+  /// append a name as an XML attribute value
+  void append_escaped(const string &s) {
+    for (char c : s) {
+      switch (c) {
+        case '&': buffer += "&amp;"; break;
+        case '<': buffer += "&lt;"; break;
+        case '>': buffer += "&gt;"; break;
+        case '"': buffer += "&quot;"; break;
+        default: buffer += c;
+      }
+    }
+  }
+
+ public:
+  xes_writer(const string &fname) : f(NULL), gz(NULL) {
+    if (fname.size()>3 and fname.compare(fname.size()-3, 3, ".gz")==0) gz = gzopen(fname.c_str(), "wb6");
+    else f = fopen(fname.c_str(), "w");
+    if (f==NULL and gz==NULL) ERROR_CRASH("Error opening output file " << fname);
+    buffer = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+             "<log xes.version=\"1.0\" xes.features=\"nested-attributes\">\n"
+             "\t<extension name=\"Concept\" prefix=\"concept\" uri=\"http://www.xes-standard.org/concept.xesext\"/>\n"
+             "\t<string key=\"source\" value=\"generate-log\"/>\n";
+  }
+
+  ~xes_writer() {
+    buffer += "</log>\n";
+    flush();
+    if (gz!=NULL) gzclose(gz);
+    else fclose(f);
+  }
+
+  void write(const string &id, const vector<string> &trace) {
+    buffer += "\t<trace>\n\t\t<string key=\"concept:name\" value=\"";
+    append_escaped(id);
+    buffer += "\"/>\n";
+    for (auto &e : trace) {
+      buffer += "\t\t<event><string key=\"concept:name\" value=\"";
+      append_escaped(e);
+      buffer += "\"/></event>\n";
+    }
+    buffer += "\t</trace>\n";
+    if (buffer.size() >= (1<<20)) flush();
+  }
+};
+
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  parameters par;
+  vector<string> args;
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    bool more = (i+1<argc);
+    if (arg=="-c" and more) par.cases = atol(argv[++i]);
+    else if (arg=="-v" and more) par.variants = atol(argv[++i]);
+    else if (arg=="-z" and more) par.skew = atof(argv[++i]);
+    else if (arg=="-l" and more) {
+      // length range min:max (or just min)
+      string r(argv[++i]);
+      size_t c = r.find(':');
+      par.min_length = atol(r.substr(0,c).c_str());
+      if (c!=string::npos) par.max_length = atol(r.substr(c+1).c_str());
+    }
+    else if (arg=="-a" and more) par.attempts = atoi(argv[++i]);
+    else if (arg=="-m" and more) par.limit = atol(argv[++i]);
+    else if (arg=="-n" and more) {
+      // noise rates swaps:insertions:deletions
+      if (sscanf(argv[++i], "%lf:%lf:%lf", &par.swaps, &par.insertions, &par.deletions) != 3) args.clear(), i=argc;
+    }
+    else if (arg=="-r" and more) par.reference = argv[++i];
+    else if (arg=="-s" and more) par.seed = atoi(argv[++i]);
+    else args.push_back(arg);
+  }
+
+  if (args.size()<2) {
+    ERROR_CRASH("Usage " << argv[0] << " [options] model.bp.pnml output [tracingoptions]\n"
+                << "         Generates a log by playing out the model. Output is XES (gzip compressed if its name ends in .gz),\n"
+                << "         or binary (see compile-log) if its name ends in .rlog. Options:\n"
+                << "           -c cases       number of cases (1000)\n"
+                << "           -v variants    draw cases from this many distinct playouts (default, one playout per case)\n"
+                << "           -z skew        Zipf exponent of playout frequencies (1.0; 0 = uniform)\n"
+                << "           -l min:max     trace length range. The closest of -a playouts (20) is kept\n"
+                << "           -m firings     maximum transitions fired per playout (10000)\n"
+                << "           -n s:i:d       probability of each event being swapped, preceded by a random event, or deleted (0:0:0)\n"
+                << "           -r log         visible tasks are the activities of this log (default, tasks not named tau*)\n"
+                << "           -s seed        random seed (1)\n"
+                << "         e.g.: " << argv[0] << " -c 1000000 -v 5000 -l 50:200 -n 0.02:0.01:0.01 data/unfoldings/M4.bp.pnml big.xes.gz");
+  }
+
+  string fmodel(args[0]);
+  string fout(args[1]);
+  traces::set_tracing(args.size()>2 ? args[2] : "");
+
+  // the net with its loops, as the aligner sees it
+  graph g(fmodel, graph::UNFOLDING, true, true);
+
+  // visible tasks and activities used for insertions
+  set<string> visible;
+  if (not par.reference.empty()) {
+    trace_log ref;
+    ref.load(par.reference);
+    for (uint32_t a=0; a<ref.num_activities(); ++a) visible.insert(ref.get_activity(a));
+  }
+  else {
+    for (auto &id : g.get_nodes_by_id()) {
+      const node &n = g.get_node(id);
+      if (n.type==node::TRANSITION and n.name.compare(0,3,"tau")!=0) visible.insert(n.name);
+    }
+  }
+  if (visible.empty()) ERROR_CRASH("No visible tasks in model " << fmodel);
+  vector<string> activities(visible.begin(), visible.end());
+
+  mt19937 rng(par.seed);
+
+  // distinct playouts the cases are drawn from, with Zipf frequencies
+  vector<vector<string>> pool;
+  discrete_distribution<size_t> pick;
+  if (par.variants>0) {
+    vector<double> freq;
+    for (long v=0; v<par.variants; ++v) {
+      pool.push_back(random_trace(g, visible, par, rng));
+      freq.push_back(1.0/pow(v+1, par.skew));
+    }
+    pick = discrete_distribution<size_t>(freq.begin(), freq.end());
+    TRACE(1, "Generated " << pool.size() << " playouts");
+  }
+
+  bool binary = (fout.size()>5 and fout.compare(fout.size()-5, 5, ".rlog")==0);
+  xes_writer *xes = (binary ? NULL : new xes_writer(fout));
+  trace_log log;
+  vector<uint32_t> evs;
+
+  long events = 0;
+  for (long c=1; c<=par.cases; ++c) {
+    vector<string> trace = add_noise(pool.empty() ? random_trace(g, visible, par, rng) : pool[pick(rng)], 
+                                     activities, par, rng);
+    events += trace.size();
+    string id = "case_" + to_string(c);
+    if (binary) {
+      evs.clear();
+      for (auto &e : trace) evs.push_back(log.intern(e));
+      log.add_case(id, evs.data(), evs.size());
+    }
+    else xes->write(id, trace);
+    if (c%100000==0) TRACE(1, c << " cases generated");
+  }
+
+  if (binary) log.save_binary(fout);
+  delete xes;
+
+  cerr << fout << ": " << par.cases << " cases, " << events << " events";
+  if (binary) cerr << ", " << log.num_variants() << " variants";
+  cerr << endl;
+}
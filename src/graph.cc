@@ -28,12 +28,14 @@
 #include <fstream>
 #include <sstream>
 #include <climits>
+#include <limits>
 #include <cmath>
 #include <iterator>
 #include <algorithm>
 
 #include "graph.h"
 #include "util.h"
+#include "timeline.h"
 
 /// Tracing and printing stuff
 #include "traces.h"
@@ -74,6 +76,7 @@ graph::graph() {}
 /// constructor from a xml file (.pnml)
 
 graph::graph(const string &fname, NetVariant which, bool addIFS, bool addLOOPS) {
+    timeline::scope ts("load net");
     // open input file
     pugi::xml_document xmldoc;
     xmldoc.load_file(fname.c_str(), pugi::parse_default|pugi::parse_ws_pcdata);
@@ -234,12 +237,15 @@ void graph::add_node(const node &n) {
     return;
   }
   nodes_by_name.insert(make_pair(n.name,n.id));
+  r.first->second.index = nodes_by_index.size();
+  nodes_by_index.push_back(&r.first->second);
 }
 
 /// remove node with given id
 
 void graph::remove_node(const string &id) {
   string name = get_node(id).name;
+  nodes_by_index[get_node(id).index] = NULL;
   remove_from_multimap(nodes_by_name, name, id);
   nodes_by_id.erase(id);
   initial_nodes.erase(id); // (just in case it was there)
@@ -376,6 +382,18 @@ const node& graph::get_node(const string &id) const {
   return check_node(id)->second;
 }
 
+/// get node with given index
+
+const node& graph::get_node(uint32_t index) const {
+  return *nodes_by_index[index];
+}
+
+/// get index of node with given id. Indices do not change while the graph exists
+
+uint32_t graph::get_index(const string &id) const {
+  return check_node(id)->second.index;
+}
+
 
 /// get ids of all nodes 
 
@@ -764,6 +782,46 @@ bool graph::find_path(const set<string> &open, const string &target, list<string
 }
 
 
+// Replay a trace on the net firing, for each event, an enabled transition with the same name.
+// If several are enabled (duplicated tasks), try them in turn, backtracking on failure, 
+// exploring at most 'limit' transition firings. Returns true if the whole trace could be
+// replayed reaching a final marking, and the fired transitions in 'fired'.
+bool graph::replay(const vector<string> &trace, vector<string> &fired, size_t limit) const {
+  fired.clear();
+  size_t budget = limit;
+  return replay(trace, 0, get_initial_nodes(), fired, budget);
+}
+
+bool graph::replay(const vector<string> &trace, size_t i, const set<string> &open,
+                   vector<string> &fired, size_t &budget) const {
+
+  if (i == trace.size()) {
+    TRACE(3,"Replay reached end of trace with open=["<<set2string(open)<<"]");
+    return includes(final_nodes.begin(), final_nodes.end(), open.begin(), open.end());
+  }
+
+  for (auto t : get_nodes_by_name(trace[i])) {
+    if (get_node(t).type != node::TRANSITION) continue;
+    // see if all markings to fire that transition are satisfied
+    set<string> pred = get_in_edges(t);
+    if (not includes(open.begin(), open.end(), pred.begin(), pred.end())) continue;
+
+    if (budget == 0) {
+      TRACE(2,"Replay budget exhausted at event "<<i<<" ("<<trace[i]<<")");
+      return false;
+    }
+    --budget;
+
+    TRACE(4,"Replaying event "<<i<<" ("<<trace[i]<<") as "<<t);
+    fired.push_back(t);
+    if (replay(trace, i+1, fire_transition(open,t), fired, budget)) return true;
+    fired.pop_back();
+  }
+
+  return false;
+}
+
+
 /// find out whether there is a path src -> targ. Requires that paths have been loaded
 
 bool graph::path_exists(const string &src, const string &targ) const {
@@ -839,26 +897,30 @@ bool graph::is_fitting(set<string> &open, const set<string> &final,
                        alignment::iterator &curr,
                        bool skip_unexpected) const {
 
-  TRACE(3,"checking is_fitting from "<< from->id <<" to " << to->id <<" open=["<< set2string(open) <<"]  final=["<< set2string(final) <<"]");
+  TRACE(3,"checking is_fitting from "<< (from->node==align_elem::NONE ? DUMMY : get_node(from->node).id)
+         <<" to " << (to->node==align_elem::NONE ? DUMMY : get_node(to->node).id) <<" open=["<< set2string(open) <<"]  final=["<< set2string(final) <<"]");
 
   curr = from;
   while (curr!=next(to)) {
     // ignore log moves
-    if (curr->type != "[L]") {
-      set<string> pred = get_in_edges(curr->id);
+    if (curr->type != align_elem::LOG) {
+      const string &id = get_node(curr->node).id;
+      set<string> pred = get_in_edges(id);
       // check if all required states are open
       if (includes(open.begin(), open.end(), pred.begin(), pred.end())) {
         open = difference_set(open, pred); // remove predecessors from open list
-        set<string> succ = get_out_edges(curr->id);
+        set<string> succ = get_out_edges(id);
         open = union_set(open,succ);       // add successors to open list
       }
       else if (not skip_unexpected) {
-        stringstream q; for (auto x=curr; x!=next(to); ++x) q<<" "<<x->id;  
-        TRACE(3,"Unexpected "<< curr->id <<" with open=["<< set2string(open) <<"]  seq=["<< q.str() <<"]");
+        if (TRACE_ENABLED(3)) {
+          stringstream q; for (auto x=curr; x!=next(to); ++x) q<<" "<<(x->node==align_elem::NONE ? DUMMY : get_node(x->node).id);
+          TRACE(3,"Unexpected "<< id <<" with open=["<< set2string(open) <<"]  seq=["<< q.str() <<"]");
+        }
         return false;
       }
       else {
-        TRACE(3,"skipping unexpected "<< curr->id);
+        TRACE(3,"skipping unexpected "<< id);
       }
     }
 
@@ -892,18 +954,20 @@ set<align_elem> graph::possible_moves(const set<string> &open, const string &eve
       set<string> diff = difference_set(get_in_edges(t), open);
       if (diff.empty()) {
 	// all required markings were in 'open', the transition can be fired
-	result.insert(align_elem(tnode.id, tnode.name, "[M-REAL]"));  // always add as model move
+	result.insert(align_elem(align_elem::MODEL, tnode.index));  // always add as model move
 	if (tnode.name == event) 
-	  result.insert(align_elem(tnode.id, tnode.name, "[L/M]"));  // if name matches, add also as sync move
+	  result.insert(align_elem(align_elem::SYNC, tnode.index));  // if name matches, add also as sync move
       }
     }
   }
 
   // log move is always possible
-  result.insert(align_elem(DUMMY, event, "[L]"));
+  result.insert(align_elem(align_elem::LOG, align_elem::NONE));
 
-  stringstream r; for (auto x : result) r << " " << x.dump(true);  
-  TRACE(4,"possible moves computed: [" << r.str() << "]");
+  if (TRACE_ENABLED(4)) {
+    stringstream r; for (auto x : result) r << " " << x.type << "/" << (x.node==align_elem::NONE ? DUMMY : get_node(x.node).id);
+    TRACE(4,"possible moves computed: [" << r.str() << "]");
+  }
 
   return result;
 }
@@ -912,16 +976,15 @@ set<align_elem> graph::possible_moves(const set<string> &open, const string &eve
 
 std::set<std::string> graph::simulate_move(const std::set<std::string> &open, const align_elem &m) const {
 
-  TRACE(5,"Simulating move "<<m.id<<"/"<<m.name<< " from ["<< set2string(open) <<"]");
-
   set<string> result;
-  if (m.type == "[L]") result = open;   // log move, no changes
+  if (m.type == align_elem::LOG) result = open;   // log move, no changes
 
   else {
     // Sync or model move.
     // New marking is current marking in 'open', removing nodes required to fire the transition, 
     // and adding nodes marked after the firing
-    result = fire_transition(open, m.id);
+    TRACE(5,"Simulating move "<<get_node(m.node).id<<"/"<<get_node(m.node).name<< " from ["<< set2string(open) <<"]");
+    result = fire_transition(open, get_node(m.node).id);
   }
   
   TRACE(5,"Marking after move is ["<< set2string(result) <<"]");
@@ -7,6 +7,7 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <cstdint>
 
 #include "pugixml.hpp"
 #include "alignment.h"
@@ -32,6 +33,8 @@ class node {
     std::string id;
     std::string name;
     bool initial_marking;
+    // position of the node in the graph index (see graph::get_index)
+    uint32_t index;
 
     node();
     node(NodeType t, const std::string &i,
@@ -49,6 +52,8 @@ class graph {
    private:
      // nodes by id 
      std::map<std::string,node> nodes_by_id;
+     // nodes by index (NULL for removed nodes)
+     std::vector<const node*> nodes_by_index;
      // nodes by name
      std::multimap<std::string,std::string> nodes_by_name;
      // target node id for edges getting out from a node, by id
@@ -78,6 +83,9 @@ class graph {
      static void remove_from_multimap(std::multimap<std::string,std::string> &mmap, const std::string &key, const std::string &val);
      /// utility: find out if there is a loop involving given node, or any accessible from it.
      bool has_loops(const std::string &node, std::set<std::string> &seen) const;
+     /// utility: replay trace from position i with given marking, backtracking on ambiguous events
+     bool replay(const std::vector<std::string> &trace, size_t i, const std::set<std::string> &open,
+                 std::vector<std::string> &fired, size_t &budget) const;
     
    public:
      // dummy label
@@ -88,6 +96,9 @@ class graph {
      graph();
      graph(const std::string &fname, NetVariant which, bool addIFS=false, bool addLOOPS=false);
      ~graph();
+     // the node index points into the graph, so it can not be copied
+     graph(const graph &) = delete;
+     graph &operator=(const graph &) = delete;
 
      void add_node(const node &n);
      void add_edge(const std::string &src, const std::string &targ);
@@ -106,6 +117,8 @@ class graph {
      bool is_initial(const std::string &id) const;
      bool is_final(const std::string &id) const;
      const node& get_node(const std::string &id) const;
+     const node& get_node(uint32_t index) const;
+     uint32_t get_index(const std::string &id) const;
      bool is_leaf(const std::string &id) const;
      int get_num_nodes() const;
      std::list<std::string> get_nodes_by_id() const;
@@ -145,6 +158,7 @@ class graph {
      int estimated_cost(const search_state & st, const std::string &target) const;
      search_state next_search_state(const search_state & current, const std::string & t) const;
      bool find_path(const std::set<std::string> &open, const std::string &target, std::list<std::string> &path) const;
+     bool replay(const std::vector<std::string> &trace, std::vector<std::string> &fired, size_t limit) const;
      bool random_path(const std::string &n, const std::string &s, std::list<std::string> &path) const;
      std::list<std::string> find_path_by_sampling(const std::string &n, const std::string &target) const;
      std::string dump() const;
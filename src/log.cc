@@ -0,0 +1,684 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "stream.h"
+#include "pool.h"
+#include "pugixml.hpp"
+#include "timeline.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "LOG"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+const uint32_t trace_log::NONE;
+const char trace_log::MAGIC[8] = {'R','L','L','O','G','0','0','2'};
+/// written in the machine byte order after the magic, to detect files from machines with another one
+static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+/// Constructor, create an empty log
+
+trace_log::trace_log() : variant_first(1,0), table(1024,NONE), case_first(1,0), node_parent(1,NONE), node_activity(1,NONE) {}
+
+/// Destructor
+
+trace_log::~trace_log() {}
+
+
+/// add a case from a <trace> element. Spaces in names are replaced with '_'
+
+static void add_trace(trace_log &log, pugi::xml_node trace, vector<uint32_t> &evs) {
+  string trace_id = trace.find_child_by_attribute("string","key","concept:name").attribute("value").value();
+  std::replace(trace_id.begin(),trace_id.end(),' ','_');
+  TRACE(7, "found new trace id="<<trace_id);
+
+  // get each event of the trace
+  evs.clear();
+  pugi::xml_node event = trace.child("event");
+  while (event) {
+    pugi::xml_node name = event.find_child_by_attribute("string","key","concept:name");
+    string evname = name.attribute("value").value();
+    std::replace(evname.begin(),evname.end(),' ','_');
+    evs.push_back(log.intern(evname));
+    TRACE(7, "   read event "<<evname);
+    event = event.next_sibling("event");
+  }
+
+  log.add_case(trace_id, evs.data(), evs.size());
+}
+
+
+/// position of string s in buf[from,n), or n if not found
+
+static size_t find(const char *buf, size_t n, size_t from, const char *s, size_t len) {
+  if (from>=n) return n;
+  const void *p = memmem(buf+from, n-from, s, len);
+  return (p==NULL ? n : (const char *)p-buf);
+}
+
+
+/// find the start of the next <trace> element in buf[from,n). Returns
+/// n if there is none (or it may be there, but is not complete yet)
+
+static size_t find_trace_start(const char *buf, size_t n, size_t from) {
+  size_t b = from;
+  while ((b = find(buf, n, b, "<trace", 6)) < n) {
+    size_t k = b+6;
+    if (k>=n) return n;  // may be a longer tag name, wait for more data
+    if (buf[k]=='>' or buf[k]=='/' or isspace((unsigned char)buf[k])) return b;
+    b = k;
+  }
+  return n;
+}
+
+
+/// find the next <trace> element in buf[from,n). Returns its start
+/// and end in 'b' and 'e', or false if there is no complete element yet. If
+/// there is no element start, 'b' is set to the position where one may begin.
+
+static bool find_trace(const char *buf, size_t n, size_t from, size_t &b, size_t &e) {
+  b = find_trace_start(buf, n, from);
+  if (b==n) {
+    // no element starts here, but the end of the buffer may hold a partial one
+    b = (n>from+6 ? n-6 : from);
+    return false;
+  }
+
+  size_t gt = find(buf, n, b, ">", 1);
+  if (gt==n) return false;
+  if (buf[gt-1]=='/') { e = gt+1; return true; } // <trace/>
+
+  e = find(buf, n, gt, "</trace>", 8);
+  if (e==n) return false;
+  e += 8;
+  return true;
+}
+
+
+/// parse all <trace> elements in buf[0,n), adding them to the log
+
+static void parse_traces(const char *buf, size_t n, trace_log &log, const string &fname) {
+  timeline::scope ts("parse chunk", n);
+  pugi::xml_document xmldoc;
+  vector<uint32_t> evs;
+  size_t b, e, from = 0;
+  while (find_trace(buf, n, from, b, e)) {
+    pugi::xml_parse_result res = xmldoc.load_buffer(buf+b, e-b, pugi::parse_default|pugi::parse_ws_pcdata);
+    if (not res) WARNING("Error parsing trace in " << fname << ": " << res.description());
+    add_trace(log, xmldoc.child("trace"), evs);
+    from = e;
+  }
+  if (find_trace_start(buf, n, from) < n)
+    WARNING("Incomplete trace at the end of " << fname << " ignored.");
+}
+
+
+/// load cases from a .xes file, or from a binary log file
+
+void trace_log::load(const string &fname, int threads) {
+  timeline::scope ts("load log");
+  if (is_binary(fname)) load_binary(fname);
+  else load_xes(fname, threads);
+}
+
+
+/// load cases from a .xes file (plain or compressed, see input_stream).
+/// The file is read in chunks and each <trace> element is parsed as soon
+/// as it is complete, so the whole document is never held in memory.
+/// Plain files may also be parsed by several threads, see load_parallel.
+
+void trace_log::load_xes(const string &fname, int threads) {
+
+  if (threads!=1) {
+    if (input_stream::format(fname)==input_stream::PLAIN) {
+      load_parallel(fname, threads);
+      return;
+    }
+    TRACE(1, "Compressed file, can not be split among threads. Loading it sequentially");
+  }
+
+  input_stream in(fname);
+  string buf, chunk;
+  pugi::xml_document xmldoc;
+  vector<uint32_t> evs;
+
+  size_t from = 0;  // first position of buf not scanned yet
+  while (in.next(chunk)) {
+    buf.append(chunk);
+
+    size_t b, e;
+    while (find_trace(buf.data(), buf.size(), from, b, e)) {
+      pugi::xml_parse_result res = xmldoc.load_buffer_inplace(&buf[b], e-b, pugi::parse_default|pugi::parse_ws_pcdata);
+      if (not res) WARNING("Error parsing trace in " << fname << ": " << res.description());
+      add_trace(*this, xmldoc.child("trace"), evs);
+      from = e;
+    }
+
+    // drop what has been parsed, keep the part of an element that is not complete yet
+    size_t keep = std::min(b, buf.size());
+    buf.erase(0, keep);
+    from = 0;
+  }
+
+  if (find_trace_start(buf.data(), buf.size(), 0) < buf.size())
+    WARNING("Incomplete trace at the end of " << fname << " ignored.");
+
+  TRACE(1, "loaded trace file");
+}
+
+
+/// load cases from a plain .xes file using several threads (0 = one per
+/// hardware thread). The file is memory mapped and split in chunks at
+/// <trace> boundaries, each chunk is parsed into its own log, with its own
+/// activity dictionary and variant table, and the chunk logs are then
+/// appended in file order.  So activity ids, variant ids and case order
+/// are the same as if the file was loaded sequentially.
+
+void trace_log::load_parallel(const string &fname, int threads) {
+
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd<0) ERROR_CRASH("Error opening file " << fname);
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+  if (size==0) { close(fd); return; }
+
+  const char *buf = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (buf==MAP_FAILED) ERROR_CRASH("Error mapping file " << fname);
+  madvise((void *)buf, size, MADV_SEQUENTIAL);
+
+  // split file in a few chunks per thread, starting at a <trace> element
+  worker_pool pool(threads);
+  size_t nchunks = 4*pool.size();
+  vector<size_t> start;
+  for (size_t k=0; k<nchunks; ++k) {
+    size_t b = find_trace_start(buf, size, std::max(k*(size/nchunks), start.empty() ? 0 : start.back()+1));
+    if (b==size) break;
+    if (start.empty() or b>start.back()) start.push_back(b);
+  }
+  start.push_back(size);
+  TRACE(1, "Parsing " << start.size()-1 << " chunks with " << pool.size() << " threads");
+
+  vector<trace_log> parts(start.size()-1);
+  for (size_t k=0; k<parts.size(); ++k) 
+    pool.submit([&,k](int) { parse_traces(buf+start[k], start[k+1]-start[k], parts[k], fname); });
+  pool.wait();
+
+  for (auto &p : parts) append(p);
+
+  munmap((void *)buf, size);
+  close(fd);
+  TRACE(1, "loaded trace file");
+}
+
+
+/// get the id of an activity, adding it if new
+
+uint32_t trace_log::intern(const string &activity) {
+  auto p = activity_ids.find(activity);
+  if (p != activity_ids.end()) return p->second;
+
+  uint32_t a = activities.size();
+  activities.push_back(activity);
+  activity_count.push_back(0);
+  activity_ids.insert(make_pair(activity, a));
+  return a;
+}
+
+
+/// hash of an event sequence (64-bit FNV-1a on activity ids)
+
+uint64_t trace_log::hash(const uint32_t *evs, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i=0; i<n; ++i) {
+    h ^= evs[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+
+/// find the variant with given events, or the empty table slot where it should go
+
+size_t trace_log::find_slot(const uint32_t *evs, size_t n, uint64_t h) const {
+  size_t mask = table.size()-1;
+  size_t s = h & mask;
+  while (table[s] != NONE) {
+    uint32_t v = table[s];
+    if (variant_hash[v]==h and variant_first[v+1]-variant_first[v]==n
+        and std::equal(evs, evs+n, events.begin()+variant_first[v]))
+      return s;
+    s = (s+1) & mask;  // linear probing
+  }
+  return s;
+}
+
+
+/// double the size of the variant table, placing variants again
+
+void trace_log::grow_table() {
+  table.assign(table.size()*2, NONE);
+  size_t mask = table.size()-1;
+  for (uint32_t v=0; v<variant_hash.size(); ++v) {
+    size_t s = variant_hash[v] & mask;
+    while (table[s] != NONE) s = (s+1) & mask;
+    table[s] = v;
+  }
+}
+
+
+/// add a case with given id and events (activity ids). Returns its variant
+
+uint32_t trace_log::add_case(const string &id, const uint32_t *evs, size_t n) {
+
+  for (size_t i=0; i<n; ++i) ++activity_count[evs[i]];
+
+  uint32_t v = add_variant(evs, n);
+  add_case(id.data(), id.size(), v);
+  return v;
+}
+
+
+/// append all cases of another log, in the same order
+
+void trace_log::append(const trace_log &other) {
+
+  // activity ids of the other log in this one
+  vector<uint32_t> amap(other.num_activities());
+  for (uint32_t a=0; a<amap.size(); ++a) {
+    amap[a] = intern(other.activities[a]);
+    activity_count[amap[a]] += other.activity_count[a];
+  }
+
+  // variant ids of the other log in this one
+  vector<uint32_t> vmap(other.num_variants()), evs;
+  for (uint32_t v=0; v<vmap.size(); ++v) {
+    evs.clear();
+    for (uint32_t i=other.variant_first[v]; i<other.variant_first[v+1]; ++i)
+      evs.push_back(amap[other.events[i]]);
+    vmap[v] = add_variant(evs.data(), evs.size());
+  }
+
+  // cases, in the order they were added to the other log
+  vector<uint32_t> variant(other.num_cases());
+  for (uint32_t v=0; v<vmap.size(); ++v) 
+    for (uint32_t c=other.first_case[v]; c!=NONE; c=other.next_case[c])
+      variant[c] = vmap[v];
+  for (uint32_t c=0; c<variant.size(); ++c)
+    add_case(other.case_chars.data()+other.case_first[c], other.case_first[c+1]-other.case_first[c], variant[c]);
+}
+
+
+/// find the variant with given events (activity ids), adding it if new
+
+uint32_t trace_log::add_variant(const uint32_t *evs, size_t n) {
+
+  // find variant, adding it if new. Table is kept at most half full
+  uint64_t h = hash(evs, n);
+  size_t s = find_slot(evs, n, h);
+  uint32_t v = table[s];
+  if (v == NONE) {
+    v = variant_hash.size();
+    events.insert(events.end(), evs, evs+n);
+    variant_first.push_back(events.size());
+    variant_hash.push_back(h);
+    first_case.push_back(NONE);
+    last_case.push_back(NONE);
+    table[s] = v;
+    if (2*variant_hash.size() > table.size()) grow_table();
+
+    variant_node.push_back(add_prefixes(evs, n));
+  }
+
+  return v;
+}
+
+
+/// add the prefixes of a variant to the trie. Returns the node where it ends
+
+uint32_t trace_log::add_prefixes(const uint32_t *evs, size_t n) {
+  uint32_t node = 0;
+  for (size_t i=0; i<n; ++i) {
+    auto p = node_child.insert(make_pair((uint64_t(node)<<32)|evs[i], uint32_t(node_parent.size())));
+    if (p.second) {
+      node_parent.push_back(node);
+      node_activity.push_back(evs[i]);
+    }
+    node = p.first->second;
+  }
+  return node;
+}
+
+
+/// add a case with given id to the case list of a variant
+
+void trace_log::add_case(const char *id, size_t len, uint32_t v) {
+  uint32_t c = next_case.size();
+  case_chars.append(id, len);
+  case_first.push_back(case_chars.size());
+  next_case.push_back(NONE);
+  if (first_case[v]==NONE) first_case[v] = c;
+  else next_case[last_case[v]] = c;
+  last_case[v] = c;
+}
+
+
+/// number of distinct activities, variants, and cases
+
+size_t trace_log::num_activities() const { return activities.size(); }
+size_t trace_log::num_variants() const { return variant_hash.size(); }
+size_t trace_log::num_cases() const { return next_case.size(); }
+
+/// name of an activity
+
+const string &trace_log::get_activity(uint32_t a) const {
+  return activities[a];
+}
+
+/// number of events with an activity
+
+uint64_t trace_log::get_activity_count(uint32_t a) const {
+  return activity_count[a];
+}
+
+
+/// event names of a variant
+
+vector<string> trace_log::get_variant(uint32_t v) const {
+  vector<string> evs;
+  evs.reserve(variant_first[v+1]-variant_first[v]);
+  for (uint32_t i=variant_first[v]; i<variant_first[v+1]; ++i) 
+    evs.push_back(activities[events[i]]);
+  return evs;
+}
+
+
+/// ids of the cases of a variant, in the order they were added
+
+vector<string> trace_log::get_cases(uint32_t v) const {
+  vector<string> ids;
+  for (uint32_t c=first_case[v]; c!=NONE; c=next_case[c])
+    ids.push_back(case_chars.substr(case_first[c], case_first[c+1]-case_first[c]));
+  return ids;
+}
+
+
+/// variant ids, sorted by their event names (as a map of event name vectors would be)
+
+vector<uint32_t> trace_log::by_name() const {
+  vector<uint32_t> order(num_variants());
+  for (uint32_t v=0; v<order.size(); ++v) order[v] = v;
+
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(events.begin()+variant_first[a], events.begin()+variant_first[a+1],
+                                          events.begin()+variant_first[b], events.begin()+variant_first[b+1],
+                                          [this](uint32_t x, uint32_t y) { return activities[x] < activities[y]; });
+    });
+  return order;
+}
+
+
+/// number of nodes in the prefix trie (including the root)
+
+size_t trace_log::num_nodes() const {
+  return node_parent.size();
+}
+
+/// trie nodes of the prefixes of a variant, of lengths 1 to the variant length
+
+vector<uint32_t> trace_log::get_path(uint32_t v) const {
+  vector<uint32_t> path(variant_first[v+1]-variant_first[v]);
+  uint32_t node = variant_node[v];
+  for (size_t i=path.size(); i>0; --i) {
+    path[i-1] = node;
+    node = node_parent[node];
+  }
+  return path;
+}
+
+/// parent of a trie node
+
+uint32_t trace_log::get_parent(uint32_t n) const {
+  return node_parent[n];
+}
+
+/// activity of the last event of a trie node prefix
+
+uint32_t trace_log::get_node_activity(uint32_t n) const {
+  return node_activity[n];
+}
+
+
+/// Binary log files hold the log in columns, each padded to 8 bytes:
+///   magic (8 bytes), byte order mark (uint64 0x0102030405060708),
+///   number of activities, variants, events, cases,
+///   and of characters of activity names and case ids (6 x uint64)
+///   first character of each activity name (uint32, plus a sentinel), names
+///   number of events with each activity (uint64)
+///   first event of each variant (uint32, plus a sentinel), events (uint32 activity ids)
+///   first character of each case id (uint32, plus a sentinel), case ids
+///   variant of each case (uint32), in case order
+/// Numbers are stored in the byte order of the machine that wrote the file,
+/// and files from machines with another byte order are rejected.
+
+/// check whether a file is a binary log
+
+bool trace_log::is_binary(const string &fname) {
+  char magic[8];
+  FILE *f = fopen(fname.c_str(), "rb");
+  if (f==NULL) return false;
+  // any version, so that load_binary reports old formats instead of parsing them as XES
+  bool bin = (fread(magic, 1, 8, f)==8 and std::equal(magic, magic+5, MAGIC));
+  fclose(f);
+  return bin;
+}
+
+
+/// write a column, padded to 8 bytes
+
+static void write_column(FILE *f, const void *data, size_t bytes) {
+  static const char zeros[8] = {0,0,0,0,0,0,0,0};
+  if (bytes>0) fwrite(data, 1, bytes, f);
+  if (bytes%8) fwrite(zeros, 1, 8-bytes%8, f);
+}
+
+
+/// save the log in binary columnar format
+
+void trace_log::save_binary(const string &fname) const {
+  FILE *f = fopen(fname.c_str(), "wb");
+  if (f==NULL) ERROR_CRASH("Error opening file " << fname);
+
+  // activity names in one arena
+  vector<uint32_t> act_first(1,0);
+  string act_chars;
+  for (auto &a : activities) {
+    act_chars.append(a);
+    act_first.push_back(act_chars.size());
+  }
+
+  // variant of each case
+  vector<uint32_t> variant(num_cases());
+  for (uint32_t v=0; v<num_variants(); ++v)
+    for (uint32_t c=first_case[v]; c!=NONE; c=next_case[c])
+      variant[c] = v;
+
+  uint64_t counts[6] = {activities.size(), num_variants(), events.size(), num_cases(), act_chars.size(), case_chars.size()};
+  write_column(f, MAGIC, 8);
+  write_column(f, &BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK));
+  write_column(f, counts, sizeof(counts));
+  write_column(f, act_first.data(), act_first.size()*sizeof(uint32_t));
+  write_column(f, act_chars.data(), act_chars.size());
+  write_column(f, activity_count.data(), activity_count.size()*sizeof(uint64_t));
+  write_column(f, variant_first.data(), variant_first.size()*sizeof(uint32_t));
+  write_column(f, events.data(), events.size()*sizeof(uint32_t));
+  write_column(f, case_first.data(), case_first.size()*sizeof(uint32_t));
+  write_column(f, case_chars.data(), case_chars.size());
+  write_column(f, variant.data(), variant.size()*sizeof(uint32_t));
+
+  if (ferror(f)) ERROR_CRASH("Error writing file " << fname);
+  fclose(f);
+}
+
+
+/// load cases from a binary log file. The file is memory mapped, and
+/// if the log is empty its columns are copied as they are into the log
+/// tables, so only the variant table and the prefix trie are built.
+/// Otherwise, its activities, variants and cases are added one by one
+/// to the log. All sizes, offsets and ids are checked before they are
+/// used, so a corrupted file is reported instead of crashing.
+
+void trace_log::load_binary(const string &fname) {
+
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd<0) ERROR_CRASH("Error opening file " << fname);
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+  const char *buf = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (buf==MAP_FAILED) ERROR_CRASH("Error mapping file " << fname);
+
+  // get next column of n elements of given size (checked without overflowing)
+  size_t pos = 0;
+  auto column = [&](uint64_t n, size_t elem) -> const char * {
+    if (n > (size-pos)/elem) ERROR_CRASH("Truncated or corrupted binary log file " << fname);
+    const char *c = buf+pos;
+    pos = std::min<uint64_t>(size, pos + (n*elem+7)/8*8);
+    return c;
+  };
+  // check that an offset column (n+1 entries) starts at 0, does not decrease, and ends within given size
+  auto check_offsets = [&](const uint32_t *first, uint64_t n, uint64_t limit, const char *what) {
+    if (first[0]!=0 or first[n]>limit) ERROR_CRASH("Corrupted binary log file " << fname << ": bad " << what << " offsets");
+    for (uint64_t i=0; i<n; ++i) 
+      if (first[i]>first[i+1]) ERROR_CRASH("Corrupted binary log file " << fname << ": bad " << what << " offsets");
+  };
+
+  if (size<16 or not std::equal(buf, buf+8, MAGIC)) 
+    ERROR_CRASH("File " << fname << " is not a binary log file, or has an old format (run compile-log again)");
+  column(8, 1);
+  if (*(const uint64_t *)column(1, sizeof(uint64_t)) != BYTE_ORDER_MARK) 
+    ERROR_CRASH("Binary log file " << fname << " was written on a machine with another byte order");
+
+  const uint64_t *counts = (const uint64_t *)column(6, sizeof(uint64_t));
+  uint64_t nact = counts[0], nvar = counts[1], nevents = counts[2], ncases = counts[3];
+  // offsets and ids are uint32
+  for (int k=0; k<6; ++k) 
+    if (counts[k] >= NONE) ERROR_CRASH("Corrupted binary log file " << fname << ": bad sizes");
+
+  const uint32_t *act_first = (const uint32_t *)column(nact+1, sizeof(uint32_t));
+  const char *act_chars = column(counts[4], 1);
+  const uint64_t *act_count = (const uint64_t *)column(nact, sizeof(uint64_t));
+  const uint32_t *var_first = (const uint32_t *)column(nvar+1, sizeof(uint32_t));
+  const uint32_t *evs = (const uint32_t *)column(nevents, sizeof(uint32_t));
+  const uint32_t *cs_first = (const uint32_t *)column(ncases+1, sizeof(uint32_t));
+  const char *cs_chars = column(counts[5], 1);
+  const uint32_t *variant = (const uint32_t *)column(ncases, sizeof(uint32_t));
+
+  check_offsets(act_first, nact, counts[4], "activity name");
+  check_offsets(var_first, nvar, nevents, "variant");
+  check_offsets(cs_first, ncases, counts[5], "case id");
+  for (uint64_t i=0; i<nevents; ++i) 
+    if (evs[i]>=nact) ERROR_CRASH("Corrupted binary log file " << fname << ": bad activity id " << evs[i]);
+  for (uint64_t c=0; c<ncases; ++c) 
+    if (variant[c]>=nvar) ERROR_CRASH("Corrupted binary log file " << fname << ": bad variant id " << variant[c]);
+
+  if (activities.empty() and variant_hash.empty() and next_case.empty()) {
+    // empty log: columns are copied as they are, and ids are kept
+    for (size_t a=0; a<nact; ++a) {
+      activities.push_back(string(act_chars+act_first[a], act_first[a+1]-act_first[a]));
+      activity_ids.insert(make_pair(activities.back(), uint32_t(a)));
+    }
+    if (activity_ids.size()!=nact) ERROR_CRASH("Corrupted binary log file " << fname << ": repeated activity names");
+    activity_count.assign(act_count, act_count+nact);
+    events.assign(evs, evs+nevents);
+    variant_first.assign(var_first, var_first+nvar+1);
+    case_chars.assign(cs_chars, counts[5]);
+    case_first.assign(cs_first, cs_first+ncases+1);
+
+    // variant table, kept at most half full, and prefix trie
+    size_t tsize = table.size();
+    while (tsize < 2*nvar) tsize *= 2;
+    table.assign(tsize, NONE);
+    variant_hash.resize(nvar);
+    variant_node.resize(nvar);
+    for (uint32_t v=0; v<nvar; ++v) {
+      const uint32_t *ve = evs+var_first[v];
+      size_t n = var_first[v+1]-var_first[v];
+      variant_hash[v] = hash(ve, n);
+      size_t s = find_slot(ve, n, variant_hash[v]);
+      if (table[s]!=NONE) ERROR_CRASH("Corrupted binary log file " << fname << ": repeated variant " << v);
+      table[s] = v;
+      variant_node[v] = add_prefixes(ve, n);
+    }
+
+    // case lists of each variant, in case order
+    first_case.assign(nvar, NONE);
+    last_case.assign(nvar, NONE);
+    next_case.assign(ncases, NONE);
+    for (uint32_t c=0; c<ncases; ++c) {
+      uint32_t v = variant[c];
+      if (first_case[v]==NONE) first_case[v] = c;
+      else next_case[last_case[v]] = c;
+      last_case[v] = c;
+    }
+  }
+
+  else {
+    // activity ids of the file in this log
+    vector<uint32_t> amap(nact);
+    for (size_t a=0; a<nact; ++a) {
+      amap[a] = intern(string(act_chars+act_first[a], act_first[a+1]-act_first[a]));
+      activity_count[amap[a]] += act_count[a];
+    }
+
+    vector<uint32_t> vmap(nvar), seq;
+    for (size_t v=0; v<nvar; ++v) {
+      seq.clear();
+      for (uint32_t i=var_first[v]; i<var_first[v+1]; ++i) seq.push_back(amap[evs[i]]);
+      vmap[v] = add_variant(seq.data(), seq.size());
+    }
+
+    for (size_t c=0; c<ncases; ++c)
+      add_case(cs_chars+cs_first[c], cs_first[c+1]-cs_first[c], vmap[variant[c]]);
+  }
+
+  munmap((void *)buf, size);
+  close(fd);
+  TRACE(1, "loaded binary log file");
+}
+
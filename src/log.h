@@ -0,0 +1,144 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __LOG_H
+#define __LOG_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class trace_log stores the cases of an event log grouped
+///  by variant (distinct event sequence).  Activity names are 
+///  interned to integer ids as they are read, variants are kept 
+///  as id sequences in a single arena and found through an open
+///  addressing hash table, and case ids are kept in a flat
+///  character arena.  No per-event strings are stored.
+///  Variants are also kept in a prefix trie, so later stages can
+///  share work among variants with a common prefix.
+///
+////////////////////////////////////////////////////////////////
+
+class trace_log {
+
+ private:
+   /// marks an empty slot in the variant table, or the end of a case list
+   static const uint32_t NONE = 0xffffffff;
+   /// first bytes of a binary log file (format version included)
+   static const char MAGIC[8];
+
+   /// activity names, their ids, and number of occurrences in the log
+   std::vector<std::string> activities;
+   std::unordered_map<std::string,uint32_t> activity_ids;
+   std::vector<uint64_t> activity_count;
+
+   /// events of all variants one after the other, and first event of each variant (plus a sentinel)
+   std::vector<uint32_t> events;
+   std::vector<uint32_t> variant_first;
+   /// hash of each variant
+   std::vector<uint64_t> variant_hash;
+   /// open addressing table of variant ids (NONE if empty). Size is a power of two
+   std::vector<uint32_t> table;
+
+   /// characters of all case ids, and first character of each case (plus a sentinel)
+   std::string case_chars;
+   std::vector<uint32_t> case_first;
+   /// cases of each variant, as a list: first and last case of the variant, and next case of each case
+   std::vector<uint32_t> first_case, last_case, next_case;
+
+   /// prefix trie: parent and activity of each node (node 0 is the root, the empty prefix),
+   /// child of a node by activity (key is parent<<32|activity), and node where each variant ends
+   std::vector<uint32_t> node_parent, node_activity;
+   std::unordered_map<uint64_t,uint32_t> node_child;
+   std::vector<uint32_t> variant_node;
+
+   /// hash of an event sequence
+   static uint64_t hash(const uint32_t *evs, size_t n);
+   /// find the variant with given events, or the table slot where it should be
+   size_t find_slot(const uint32_t *evs, size_t n, uint64_t h) const;
+   /// double the size of the variant table
+   void grow_table();
+   /// find the variant with given events (activity ids), adding it if new
+   uint32_t add_variant(const uint32_t *evs, size_t n);
+   /// add the prefixes of a variant to the trie. Returns the node where it ends
+   uint32_t add_prefixes(const uint32_t *evs, size_t n);
+   /// add a case with given id to the case list of a variant
+   void add_case(const char *id, size_t len, uint32_t v);
+   /// load cases from a plain .xes file using several threads
+   void load_parallel(const std::string &fname, int threads);
+   /// load cases from a binary log file (see save_binary)
+   void load_binary(const std::string &fname);
+
+ public:
+   /// Constructor
+   trace_log();
+   /// Destructor
+   ~trace_log();
+
+   /// load cases from a .xes file, or from a binary log file created by save_binary
+   void load(const std::string &fname, int threads=1);
+   /// load cases from a .xes file. Spaces in names are replaced with '_'.
+   /// Plain files are parsed with given number of threads (0 = one per core)
+   void load_xes(const std::string &fname, int threads=1);
+   /// save the log in binary columnar format, to be loaded faster than XES
+   void save_binary(const std::string &fname) const;
+   /// check whether a file is a binary log
+   static bool is_binary(const std::string &fname);
+   /// append all cases of another log, in the same order
+   void append(const trace_log &other);
+
+   /// get the id of an activity, adding it if new
+   uint32_t intern(const std::string &activity);
+   /// add a case with given id and events (activity ids). Returns its variant
+   uint32_t add_case(const std::string &id, const uint32_t *evs, size_t n);
+
+   /// number of distinct activities, variants, and cases
+   size_t num_activities() const;
+   size_t num_variants() const;
+   size_t num_cases() const;
+   /// name of an activity, and number of events with it
+   const std::string &get_activity(uint32_t a) const;
+   uint64_t get_activity_count(uint32_t a) const;
+   /// event names of a variant
+   std::vector<std::string> get_variant(uint32_t v) const;
+   /// ids of the cases of a variant, in the order they were added
+   std::vector<std::string> get_cases(uint32_t v) const;
+   /// variant ids, sorted by their event names
+   std::vector<uint32_t> by_name() const;
+
+   /// number of nodes in the prefix trie (including the root, node 0)
+   size_t num_nodes() const;
+   /// trie nodes of the prefixes of a variant, of lengths 1 to the variant length
+   std::vector<uint32_t> get_path(uint32_t v) const;
+   /// parent and activity of a trie node
+   uint32_t get_parent(uint32_t n) const;
+   uint32_t get_node_activity(uint32_t n) const;
+};
+
+#endif
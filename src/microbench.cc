@@ -0,0 +1,241 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "aligner.h"
+#include "floyd.h"
+#include "log.h"
+#include "allocount.h"
+#include "traces.h"
+#define MOD_TRACENAME "MICROBENCH"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// time spent in each sample of a kernel (at least), and number of samples
+double MIN_SAMPLE_TIME = 0.02;
+int SAMPLES = 21;
+
+///////////////////////////////////////////////////////
+/// median of some values
+
+double median(vector<double> v) {
+  sort(v.begin(), v.end());
+  size_t n = v.size();
+  return (n%2==1 ? v[n/2] : (v[n/2-1]+v[n/2])/2);
+}
+
+///////////////////////////////////////////////////////
+/// benchmark a kernel over n inputs: run(i) runs it on input i.
+/// If setup is given, it is called (untimed) before each run, and
+/// each run is timed separately; otherwise whole passes over the
+/// inputs are timed.  Each sample repeats passes until it takes 
+/// MIN_SAMPLE_TIME, and median and median absolute deviation of
+/// the samples are reported, with allocations per operation and
+/// throughput (in bytes per second if bytes per operation are given).
+
+void bench(const string &name, size_t n, const function<void(size_t)> &setup, 
+           const function<void(size_t)> &run, double bytes=0) {
+
+  if (n==0) {
+    cout << name << ": no inputs" << endl;
+    return;
+  }
+
+  typedef chrono::steady_clock clock;
+  // one pass over the inputs: returns its time in seconds, and counts its allocations
+  auto pass = [&](long &allocs) {
+    double t = 0;
+    if (setup) {
+      for (size_t i=0; i<n; ++i) {
+        setup(i);
+        long a0 = allocation_count();
+        auto t0 = clock::now();
+        run(i);
+        chrono::duration<double> d = clock::now()-t0;
+        allocs += allocation_count()-a0;
+        t += d.count();
+      }
+    }
+    else {
+      long a0 = allocation_count();
+      auto t0 = clock::now();
+      for (size_t i=0; i<n; ++i) run(i);
+      chrono::duration<double> d = clock::now()-t0;
+      allocs += allocation_count()-a0;
+      t = d.count();
+    }
+    return t;
+  };
+
+  // warm up, and find how many passes fill a sample
+  long allocs = 0;
+  double t = pass(allocs);
+  int reps = std::max(1, int(ceil(MIN_SAMPLE_TIME/std::max(t,1e-9))));
+
+  vector<double> ns;
+  allocs = 0;
+  for (int s=0; s<SAMPLES; ++s) {
+    double st = 0;
+    for (int r=0; r<reps; ++r) st += pass(allocs);
+    ns.push_back(st*1e9/(reps*n));
+  }
+
+  double med = median(ns);
+  vector<double> dev;
+  for (double x : ns) dev.push_back(fabs(x-med));
+  double mad = median(dev);
+  double per_op_allocs = double(allocs)/(double(SAMPLES)*reps*n);
+
+  printf("%-22s %8zu %14.1f %7.1f%% %14.1f %10.1f ", name.c_str(), n, med, 100*mad/med, 
+         *min_element(ns.begin(), ns.end()), per_op_allocs);
+  if (bytes>0) printf("%10.1f MB/s\n", bytes/med*1e3);
+  else printf("%10.0f op/s\n", 1e9/med);
+  fflush(stdout);
+}
+
+///////////////////////////////////////////////////////
+/// capture the find_path calls made while gap-filling an alignment:
+/// marking after the previous synchronous move, and the transition of
+/// the next one.  Also keep all markings reached.
+
+void capture_queries(const alignment &seq, const graph &g, 
+                     vector<pair<set<string>,string>> &queries, vector<set<string>> &markings) {
+  set<string> open = g.get_initial_nodes();
+  set<string> query = open;
+  for (auto &e : seq) {
+    if (e.type==align_elem::LOG or e.type==align_elem::ANCHOR) continue;
+    markings.push_back(open);
+    if (e.type==align_elem::SYNC) queries.push_back(make_pair(query, seq.id(e)));
+    open = g.fire_transition(open, seq.id(e));
+    if (e.type==align_elem::SYNC) query = open;
+  }
+}
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+int main(int argc, char *argv[]) {
+
+  vector<string> args;
+  set<string> kernels;
+  size_t nvariants = 50;
+  string tracing;
+  for (int i=1; i<argc; ++i) {
+    string arg(argv[i]);
+    if (arg=="-n" and i+1<argc) nvariants = atoi(argv[++i]);
+    else if (arg=="-s" and i+1<argc) SAMPLES = atoi(argv[++i]);
+    else if (arg=="-t" and i+1<argc) tracing = argv[++i];
+    else if (args.size()<3) args.push_back(arg);
+    else kernels.insert(arg);
+  }
+
+  if (args.size()<3) {
+    ERROR_CRASH("Usage " << argv[0] << " [-n variants] [-s samples] [-t tracingoptions] model-prefix traces config [kernel ..]\n         Runs micro-benchmarks of the core kernels on inputs taken from the given model and log.\n         Kernels are: load solve add_constraints find_path possible_transitions floyd (default all)\n         e.g.: "<<argv[0] << " modelsdir/M1 logsdir/M1.xes configdir/cfile.cfg solve find_path");
+  }
+  traces::set_tracing(tracing);
+  auto selected = [&kernels](const string &k) { return kernels.empty() or kernels.count(k)>0; };
+
+  string basename(args[0]);
+  string ftrace(args[1]);
+  string fconfig(args[2]);
+
+  model m(basename, fconfig);
+  trace_log log;
+  log.load(ftrace, 1);
+
+  // inputs: the first variants (in output order) short enough to be solved as one problem
+  vector<vector<string>> traces;
+  for (uint32_t v : log.by_name()) {
+    if (traces.size()>=nvariants) break;
+    vector<string> trace = log.get_variant(v);
+    if (m.cfg.WINDOW_SIZE==0 or int(trace.size())<=m.cfg.WINDOW_SIZE) traces.push_back(trace);
+  }
+
+  printf("# %zu variants of %s, %d samples of at least %gs\n", traces.size(), ftrace.c_str(), SAMPLES, MIN_SAMPLE_TIME);
+  printf("%-22s %8s %14s %8s %14s %10s %15s\n", "# kernel", "inputs", "ns/op", "MAD", "min ns/op", "allocs/op", "throughput");
+
+  if (selected("load")) {
+    ifstream f(ftrace, ios::binary|ios::ate);
+    double bytes = f.tellg();
+    bench("load", 1, NULL, [&](size_t) { trace_log l; l.load(ftrace, 1); }, bytes);
+  }
+
+  if (selected("solve")) {
+    relax solver(m.cfg.MAX_ITER, m.cfg.SCALE_FACTOR, m.cfg.EPSILON, m.cfg.PRUNE_THRESHOLD);
+    vector<problem> probs(traces.size());
+    for (size_t i=0; i<traces.size(); ++i) build_labeling_problem(probs[i], traces[i], m);
+    problem work;
+    bench("relax::solve", probs.size(), [&](size_t i) { work = probs[i]; }, [&](size_t) { solver.solve(work); });
+  }
+
+  if (selected("add_constraints")) {
+    problem prob;
+    bench("add_constraints", traces.size(), 
+          [&](size_t i) { prob.reset(traces[i].size()); add_variable_labels(prob, traces[i], m.g, m.cfg); },
+          [&](size_t i) { add_constraints(prob, traces[i], m); });
+  }
+
+  if (selected("find_path") or selected("possible_transitions")) {
+    vector<pair<set<string>,string>> queries;
+    vector<set<string>> markings;
+    aligner a(m);
+    for (auto &t : traces) {
+      bool fits;
+      capture_queries(a.align(t, fits), m.g, queries, markings);
+    }
+
+    if (selected("find_path"))
+      bench("graph::find_path", queries.size(), NULL, 
+            [&](size_t i) { list<string> path; m.g.find_path(queries[i].first, queries[i].second, path); });
+    if (selected("possible_transitions"))
+      bench("possible_transitions", markings.size(), NULL, 
+            [&](size_t i) { m.g.possible_transitions(markings[i]); });
+  }
+
+  if (selected("floyd")) {
+    // same graph the paths program uses for the .tt.path file
+    graph g(basename+".bp.pnml", graph::UNFOLDING, true, true);
+    g.add_node(node(node::TRANSITION, graph::DUMMY, graph::DUMMY));
+    // init_path_matrix changes the search limits, keep the ones set for alignment
+    size_t limit = graph::BFS_LIMIT, samples = graph::NUM_SAMPLE_PATHS;
+    map<string,list<string>> init, paths;
+    map<string,string> parallels;
+    init_path_matrix(g, init, parallels);
+    graph::BFS_LIMIT = limit;
+    graph::NUM_SAMPLE_PATHS = samples;
+    bench("floyd", 1, [&](size_t) { paths = init; }, [&](size_t) { floyd(g, paths, parallels); });
+  }
+}
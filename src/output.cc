@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <set>
+
+#include "output.h"
+#include "timeline.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "OUTPUT"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// Constructor. In binary format, write the header with the name table
+
+result_writer::result_writer(FILE *f, format_type t, const graph &g, const trace_log &log) : out(f), fmt(t), nvariants(0) {
+  buffer.reserve(BUFFER_SIZE + 64*1024);
+  if (fmt != BINARY) return;
+
+  set<string> all;
+  for (auto &id : g.get_nodes_by_id())
+    if (g.get_node(id).type == node::TRANSITION) all.insert(g.get_node(id).name);
+  for (uint32_t a=0; a<log.num_activities(); ++a) all.insert(log.get_activity(a));
+
+  buffer.append("RLALN001");
+  put<uint32_t>(all.size());
+  for (auto &n : all) {
+    names.insert(make_pair(n, uint32_t(names.size())));
+    buffer.append(n);
+    buffer.push_back('\0');
+  }
+}
+
+/// Destructor, write remaining output
+
+result_writer::~result_writer() {
+  flush(true);
+  fflush(out);
+}
+
+/// write buffer if it is large enough (or always, if forced)
+
+void result_writer::flush(bool force) {
+  if (buffer.empty() or (not force and buffer.size()<BUFFER_SIZE)) return;
+  if (fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) 
+    ERROR_CRASH("Error writing alignments");
+  buffer.clear();
+}
+
+/// append a number in binary form
+
+template <class T> 
+void result_writer::put(T x) {
+  buffer.append((const char *)&x, sizeof(T));
+}
+
+/// encode an alignment as binary moves. Return false if some move can not be encoded
+
+bool result_writer::encode(const alignment &a, vector<uint32_t> &moves) const {
+  moves.clear();
+  for (auto &e : a) {
+    uint32_t code;
+    if (e.type == align_elem::LOG) code = LOG_MOVE;
+    else if (e.type == align_elem::SYNC) code = SYNC_MOVE;
+    else if (e.type == align_elem::MODEL) code = MODEL_MOVE;
+    else {
+      WARNING("Unexpected move '" << a.dump(e) << "' in alignment");
+      return false;
+    }
+
+    auto n = names.find(a.name(e));
+    if (n == names.end()) {
+      WARNING("Unknown name in move '" << a.dump(e) << "'");
+      return false;
+    }
+    moves.push_back(code<<30 | n->second);
+  }
+  return true;
+}
+
+/// encode a text alignment ("[type]name|[type]name...") as binary moves. Return false
+/// if some move can not be encoded (e.g. names containing '|' or ']' can not be parsed)
+
+bool result_writer::encode(const string &solution, vector<uint32_t> &moves) const {
+  moves.clear();
+  size_t p = 0;
+  while (p < solution.size()) {
+    size_t q = solution.find('|', p);
+    if (q == string::npos) q = solution.size();
+    size_t t = solution.find(']', p);
+    if (t == string::npos or t > q) {
+      WARNING("Unexpected move '" << solution.substr(p,q-p) << "' in alignment");
+      return false;
+    }
+
+    string type = solution.substr(p, t+1-p);
+    uint32_t code;
+    if (type == "[L]") code = LOG_MOVE;
+    else if (type == "[L/M]") code = SYNC_MOVE;
+    else if (type == "[M-REAL]") code = MODEL_MOVE;
+    else {
+      WARNING("Unexpected move type " << type << " in alignment");
+      return false;
+    }
+
+    auto n = names.find(solution.substr(t+1, q-t-1));
+    if (n == names.end()) {
+      WARNING("Unknown name in move '" << solution.substr(p,q-p) << "'");
+      return false;
+    }
+    moves.push_back(code<<30 | n->second);
+    p = q+1;
+  }
+  return true;
+}
+
+/// write the alignment of a variant, for all its cases. In binary format, a variant
+/// whose moves can not be encoded is skipped (with a warning), and the rest are written
+
+void result_writer::write(const string &solution, const string &fitting, double time, const vector<string> &cases,
+                          const alignment *a) {
+  timeline::scope ts("output", cases.size());
+  char num[32];
+  snprintf(num, sizeof(num), "%g", time);  // as ostream would print it
+
+  switch (fmt) {
+  case TEXT:
+    for (auto &c : cases) {
+      buffer.append(c).append("  ").append(solution).append(" ").append(fitting).append(" ");
+      buffer.append(num).push_back('\n');
+      num[0] = '0'; num[1] = '\0';   // time is only attributed to the first case
+    }
+    break;
+
+  case COMPACT: {
+    string k = "@" + to_string(nvariants);
+    buffer.append(k).append(" ").append(solution).append(" ").append(fitting).append(" ");
+    buffer.append(num).push_back('\n');
+    for (auto &c : cases) 
+      buffer.append(c).append(" ").append(k).push_back('\n');
+    break;
+  }
+
+  case BINARY: {
+    vector<uint32_t> moves;
+    if (not (a!=NULL ? encode(*a, moves) : encode(solution, moves))) {
+      WARNING("Alignment of case " << (cases.empty() ? string("") : cases[0]) << " (and synonyms) can not be written in binary format, skipped");
+      return;
+    }
+    buffer.push_back('V');
+    put<uint32_t>(moves.size());
+    buffer.append((const char *)moves.data(), moves.size()*sizeof(uint32_t));
+    put<uint8_t>(fitting=="FITTING");
+    put<double>(time);
+    for (auto &c : cases) {
+      buffer.push_back('C');
+      put<uint32_t>(nvariants);
+      put<uint32_t>(c.size());
+      buffer.append(c);
+    }
+    break;
+  }
+  }
+
+  ++nvariants;
+  flush();
+}
+
+/// format with given name
+
+result_writer::format_type result_writer::format(const string &name) {
+  if (name == "text") return TEXT;
+  else if (name == "compact") return COMPACT;
+  else if (name == "binary") return BINARY;
+  ERROR_CRASH("Unknown output format '" << name << "'. Use text, compact, or binary");
+  return TEXT;
+}
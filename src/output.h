@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __OUTPUT_H
+#define __OUTPUT_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdint>
+
+#include "graph.h"
+#include "log.h"
+#include "alignment.h"
+
+////////////////////////////////////////////////////////////////
+///
+///  The class result_writer writes the alignments of a log, one
+///  variant at a time, through a large buffer (no flush per line).
+///  Formats are:
+///   - text: one line per case: "case-id  alignment fitting time"
+///   - compact: each distinct alignment is written once, as
+///        "@k alignment fitting time", followed by one "case-id @k"
+///        line per case of the variant (bin/expand-output.sh turns 
+///        it back into text format)
+///   - binary: a name table, and then the same records as compact,
+///        with moves encoded as 32-bit integers (see below)
+///
+////////////////////////////////////////////////////////////////
+
+class result_writer {
+
+ public:
+   typedef enum {TEXT, COMPACT, BINARY} format_type;
+
+   /// Binary format (numbers in machine byte order):
+   ///   magic "RLALN001", number of names (uint32), and the names, each ending with '\0'.
+   ///   Names are model transition names and log activities, sorted.
+   ///   A variant record is 'V', number of moves (uint32), moves, fitting (uint8) and time (double).
+   ///   A case record is 'C', variant number (uint32, in order of variant records),
+   ///   case id length (uint32) and case id.
+   ///   Each move is its type (upper 2 bits) and the index of its name (lower 30 bits)
+   typedef enum {LOG_MOVE=0, SYNC_MOVE=1, MODEL_MOVE=2} move_type;
+
+ private:
+   /// output file and format
+   FILE *out;
+   format_type fmt;
+   /// output waiting to be written
+   std::string buffer;
+   /// index of each name, for binary format
+   std::map<std::string,uint32_t> names;
+   /// variants written so far
+   uint32_t nvariants;
+
+   /// write buffer if it is large enough (or always, if forced)
+   void flush(bool force=false);
+   /// append a number in binary form
+   template <class T> void put(T x);
+   /// encode an alignment as binary moves, from its moves or from its text.
+   /// Return false if some move can not be encoded
+   bool encode(const alignment &a, std::vector<uint32_t> &moves) const;
+   bool encode(const std::string &solution, std::vector<uint32_t> &moves) const;
+
+ public:
+   /// size reached by the buffer before it is written
+   static const size_t BUFFER_SIZE = 1<<20;
+
+   /// Constructor, given the output file, format, and the model and log being aligned
+   result_writer(FILE *f, format_type fmt, const graph &g, const trace_log &log);
+   /// Destructor, write remaining output
+   ~result_writer();
+
+   /// write the alignment of a variant, for all its cases. Time is attributed to the first case.
+   /// In binary format, moves are taken from the alignment if given, and else parsed from the text
+   void write(const std::string &solution, const std::string &fitting, double time, const std::vector<std::string> &cases,
+              const alignment *a=NULL);
+
+   /// format with given name (text, compact, or binary)
+   static format_type format(const std::string &name);
+};
+
+#endif
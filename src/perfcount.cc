@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <sstream>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perfcount.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "PERFCOUNT"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// Sample constructor, all zero
+
+perf_counters::sample::sample() : time(0) {
+  for (int e=0; e<NUM_EVENTS; ++e) count[e] = enabled[e] = running[e] = 0;
+}
+
+/// whether the counter ran at all during the sample
+
+bool perf_counters::sample::counted(event e) const {
+  return running[e]>0;
+}
+
+/// whether the counter only ran for part of the sample
+
+bool perf_counters::sample::scaled(event e) const {
+  return running[e]>0 and running[e]<enabled[e];
+}
+
+/// count of the event, scaled to the whole sample time if the counter was multiplexed
+
+double perf_counters::sample::value(event e) const {
+  if (not scaled(e)) return double(count[e]);
+  return double(count[e])*enabled[e]/running[e];
+}
+
+/// difference of two samples (counters are monotonic, so a later minus an earlier sample is positive)
+
+perf_counters::sample perf_counters::sample::operator-(const sample &s) const {
+  sample d;
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    d.count[e] = count[e]-s.count[e];
+    d.enabled[e] = enabled[e]-s.enabled[e];
+    d.running[e] = running[e]-s.running[e];
+  }
+  d.time = time-s.time;
+  return d;
+}
+
+/// accumulate a sample
+
+perf_counters::sample &perf_counters::sample::operator+=(const sample &s) {
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    count[e] += s.count[e];
+    enabled[e] += s.enabled[e];
+    running[e] += s.running[e];
+  }
+  time += s.time;
+  return *this;
+}
+
+/// share of a sample
+
+perf_counters::sample perf_counters::sample::operator/(int n) const {
+  sample d;
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    d.count[e] = count[e]/n;
+    d.enabled[e] = enabled[e]/n;
+    d.running[e] = running[e]/n;
+  }
+  d.time = time/n;
+  return d;
+}
+
+
+/// Constructor, open counters for the calling thread, user space only
+/// (which is what unprivileged processes are allowed to count).
+/// Counters are put in a group, so they are scheduled together, and
+/// each read also gives the time the counter was enabled and running
+
+perf_counters::perf_counters() {
+  for (int e=0; e<NUM_EVENTS; ++e) fd[e] = -1;
+
+#ifdef __linux__
+  const uint64_t config[NUM_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  int leader = -1;
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[e];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd[e] = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+    if (fd[e]<0) {
+      TRACE(2, "Counter " << name(event(e)) << " not available: " << strerror(errno));
+      fd[e] = -1;
+    }
+    else if (leader<0) leader = fd[e];
+  }
+#endif
+}
+
+/// Destructor, close counters
+
+perf_counters::~perf_counters() {
+  for (int e=0; e<NUM_EVENTS; ++e) 
+    if (fd[e]>=0) close(fd[e]);
+}
+
+/// check whether a counter could be opened
+
+bool perf_counters::available(event e) const { return fd[e]>=0; }
+
+/// check whether a counter could be opened and ran during the sample
+
+bool perf_counters::counted(const sample &s, event e) const { return fd[e]>=0 and s.counted(e); }
+
+/// check whether any counter could be opened
+
+bool perf_counters::any_available() const {
+  for (int e=0; e<NUM_EVENTS; ++e) 
+    if (fd[e]>=0) return true;
+  return false;
+}
+
+/// name of an event
+
+string perf_counters::name(event e) {
+  switch (e) {
+    case CYCLES: return "cycles";
+    case INSTRUCTIONS: return "instructions";
+    case CACHE_MISSES: return "cache-misses";
+    case BRANCH_MISSES: return "branch-misses";
+    default: return "?";
+  }
+}
+
+/// current values of the counters, with their enabled and running
+/// times, and thread CPU time
+
+perf_counters::sample perf_counters::read() const {
+  sample s;
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    uint64_t v[3];  // value, time enabled, time running
+    if (fd[e]>=0 and ::read(fd[e], v, sizeof(v))==sizeof(v)) {
+      s.count[e] = v[0];
+      s.enabled[e] = v[1];
+      s.running[e] = v[2];
+    }
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  s.time = ts.tv_sec + ts.tv_nsec*1e-9;
+  return s;
+}
+
+/// one line summary of a sample. Unavailable counters are omitted, so
+/// only the CPU time is given if none is available. Counters that did
+/// not run are reported as not counted, and multiplexed ones as scaled
+
+string perf_counters::summary(const sample &s, double units, const string &unit) const {
+  ostringstream out;
+  out.precision(3);
+  out << s.time << "s";
+  for (int e=0; e<NUM_EVENTS; ++e) {
+    if (fd[e]<0) continue;
+    if (not s.counted(event(e))) out << ", " << name(event(e)) << " not counted";
+    else {
+      out << ", " << s.value(event(e)) << " " << name(event(e));
+      if (s.scaled(event(e))) out << " (scaled, counted " << 100.0*s.running[e]/s.enabled[e] << "% of time)";
+    }
+  }
+
+  if (counted(s, CYCLES) and counted(s, INSTRUCTIONS) and s.value(CYCLES)>0) 
+    out << ", IPC " << s.value(INSTRUCTIONS)/s.value(CYCLES);
+  if (units>0) {
+    out << ", per " << unit << ": " << 1e6*s.time/units << "us";
+    if (counted(s, INSTRUCTIONS)) out << " " << s.value(INSTRUCTIONS)/units << " instructions";
+    if (counted(s, CACHE_MISSES)) out << " " << s.value(CACHE_MISSES)/units << " cache-misses";
+    if (counted(s, BRANCH_MISSES)) out << " " << s.value(BRANCH_MISSES)/units << " branch-misses";
+  }
+  return out.str();
+}
@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __PERFCOUNT_H
+#define __PERFCOUNT_H
+
+#include <string>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class perf_counters reads hardware performance counters
+///  (cycles, instructions, cache and branch misses) of the calling 
+///  thread using Linux perf_event_open, so that they can be
+///  measured around the phases of the alignment.  Counters that
+///  can not be opened (no permission, virtual machines, other
+///  systems) read as zero and are reported as unavailable; the 
+///  thread CPU time is always measured.  When the kernel has to
+///  multiplex counters, they only run part of the time, so counts
+///  are scaled by the time each counter was enabled over the time
+///  it was running, and reported as scaled.
+///
+////////////////////////////////////////////////////////////////
+
+class perf_counters {
+
+ public:
+   /// measured events
+   typedef enum {CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, NUM_EVENTS} event;
+
+   /// counter values and thread CPU time (in seconds), as read or accumulated.
+   /// For each counter, the time it was enabled and running (in ns) is also kept
+   class sample {
+    public:
+      uint64_t count[NUM_EVENTS];
+      uint64_t enabled[NUM_EVENTS], running[NUM_EVENTS];
+      double time;
+
+      sample();
+      /// whether the counter ran at all during the sample
+      bool counted(event e) const;
+      /// whether the counter only ran for part of the sample
+      bool scaled(event e) const;
+      /// count of the event, scaled to the whole sample time if the counter was multiplexed
+      double value(event e) const;
+      sample operator-(const sample &s) const;
+      sample &operator+=(const sample &s);
+      /// share of the sample (e.g. for each of n problems solved together)
+      sample operator/(int n) const;
+   };
+
+ private:
+   /// file descriptor of each counter (-1 if not available)
+   int fd[NUM_EVENTS];
+
+ public:
+   /// Constructor, opens and starts the counters for the calling thread
+   perf_counters();
+   /// Destructor, closes the counters
+   ~perf_counters();
+
+   /// check whether a counter, or any of them, could be opened
+   bool available(event e) const;
+   bool any_available() const;
+   /// check whether a counter could be opened and ran during the sample
+   bool counted(const sample &s, event e) const;
+   /// name of an event
+   static std::string name(event e);
+
+   /// current values of the counters (they must be read from the thread that created them)
+   sample read() const;
+   /// one line summary of a sample: counters, instructions per cycle, 
+   /// and misses per unit of work (e.g. per constraint)
+   std::string summary(const sample &s, double units, const std::string &unit) const;
+};
+
+#endif
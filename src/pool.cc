@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+
+#include "pool.h"
+#include "timeline.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "POOL"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// Constructor, start given number of workers (0 = one per hardware thread)
+
+worker_pool::worker_pool(int n) : busy(0), stopping(false) {
+  if (n<=0) n = std::max(1u, thread::hardware_concurrency());
+  for (int w=0; w<n; ++w) 
+    workers.push_back(thread(&worker_pool::run, this, w));
+  TRACE(1, "Started " << n << " workers");
+}
+
+/// Destructor, finish pending tasks and stop workers
+
+worker_pool::~worker_pool() {
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  available.notify_all();
+  for (auto &w : workers) w.join();
+}
+
+/// number of workers
+
+int worker_pool::size() const {
+  return workers.size();
+}
+
+/// queue a task
+
+void worker_pool::submit(const task &t) {
+  {
+    lock_guard<mutex> lock(mtx);
+    tasks.push(t);
+    ++busy;
+  }
+  available.notify_one();
+}
+
+/// wait until all queued tasks are finished
+
+void worker_pool::wait() {
+  unique_lock<mutex> lock(mtx);
+  idle.wait(lock, [this]{ return busy==0; });
+}
+
+/// worker thread loop: run tasks until the pool is destroyed and the queue is empty
+
+void worker_pool::run(int worker) {
+  timeline::thread_name("worker " + to_string(worker));
+  while (true) {
+    task t;
+    {
+      unique_lock<mutex> lock(mtx);
+      available.wait(lock, [this]{ return stopping or not tasks.empty(); });
+      if (tasks.empty()) return;
+      t = tasks.front();
+      tasks.pop();
+    }
+
+    t(worker);
+
+    {
+      lock_guard<mutex> lock(mtx);
+      --busy;
+    }
+    idle.notify_all();
+  }
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __POOL_H
+#define __POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class worker_pool runs tasks on a fixed set of threads.
+///  Each task receives the number of the worker running it, so 
+///  it can use per-worker state (e.g. one aligner per worker)
+///  without locking.
+///
+////////////////////////////////////////////////////////////////
+
+class worker_pool {
+
+ public:
+   typedef std::function<void(int)> task;
+
+ private:
+   /// worker threads
+   std::vector<std::thread> workers;
+   /// pending tasks
+   std::queue<task> tasks;
+   /// tasks queued or running
+   int busy;
+   /// set when the pool is being destroyed
+   bool stopping;
+   /// synchronization of the queue
+   std::mutex mtx;
+   std::condition_variable available, idle;
+
+   /// worker thread loop
+   void run(int worker);
+
+ public:
+   /// Constructor, start given number of workers (0 = one per hardware thread)
+   worker_pool(int n=0);
+   /// Destructor, finish pending tasks and stop workers
+   ~worker_pool();
+
+   /// number of workers
+   int size() const;
+   /// queue a task
+   void submit(const task &t);
+   /// wait until all queued tasks are finished
+   void wait();
+};
+
+#endif
@@ -25,8 +25,10 @@
 ////////////////////////////////////////////////////////////////
 
 #include <cmath>
+#include <algorithm>
 
 #include "relax.h"
+#include "timeline.h"
 #include "traces.h"
 
 using namespace std;
@@ -34,7 +36,6 @@ using namespace std;
 #define MOD_TRACENAME "RELAX"
 #define MOD_TRACECODE RELAX_TRACE
 
-
   //---------- Class problem ----------------------------------
 
   ////////////////////////////////////////////////////////////////
@@ -45,10 +46,80 @@ using namespace std;
   ///////////////////////////////////////////////////////////////
 
   problem::problem(int nv) {
-    // allocate tables for the new sentence. One variable for each word in the sentence
-    vars = vector<vector<label> >(nv,vector<label>());
-    varnames = vector<string>(nv);
+    num_vars=0; num_labels=0;
+    resets=0; growths=0;
+    reset(nv);
+    resets=0;
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  Empty the problem so it can be reused for a new one with 
+  ///  nv variables. Tables keep their allocated memory, so no
+  ///  allocation is needed unless the new problem is larger than
+  ///  any previous one.
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  void problem::reset(int nv) {
+    for (int v=0; v<num_vars; v++) vars[v].clear();
+    if (int(vars.size()) < nv) {
+      ++growths;
+      vars.resize(nv);
+      varnames.resize(nv);
+    }
+    fixed.assign(vars.size(), false);
+    num_vars = nv;
+    num_labels = 0;
+    constraints.clear();
+    terms.clear();
+    elements.clear();
     CURRENT=0; NEXT=1;
+    ++resets;
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  Append an item to a pool table, counting when the table
+  ///  had to grow its allocated memory
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  template <class T> 
+  void problem::append(vector<T> &table, const T &x) {
+    if (table.size() == table.capacity()) ++growths;
+    table.push_back(x);
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  add a variable with no labels at the end of the problem,
+  ///  e.g. to extend it with a new event.  Returns its position
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  int problem::add_variable(const string &name) {
+    if (num_vars == int(vars.size())) {
+      append(vars, vector<int>());
+      append(varnames, name);
+      fixed.push_back(false);
+    }
+    else {
+      vars[num_vars].clear();
+      varnames[num_vars] = name;
+      fixed[num_vars] = false;
+    }
+    return num_vars++;
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  get number of variables
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  int problem::get_num_vars() const {
+    return num_vars;
   }
 
   ///////////////////////////////////////////////////////////////
@@ -58,6 +129,7 @@ using namespace std;
   ///////////////////////////////////////////////////////////////
 
   void problem::set_var_name(int i, const string &vname) {
+    if (varnames[i].capacity() < vname.size()) ++growths;
     varnames[i] = vname;
   }
   
@@ -89,24 +161,99 @@ using namespace std;
   ///////////////////////////////////////////////////////////////
 
   string problem::get_label_name(int i, int j) const {
-    return vars[i][j].get_name();
+    return labels[vars[i][j]].get_name();
   }
 
-  
   ///////////////////////////////////////////////////////////////
   ///
-  ///  Add a label (and its weight) to the i-th variable
+  ///  get current weight of a variable label
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  double problem::get_label_weight(int i, int j) const {
+    return labels[vars[i][j]].weight[CURRENT];
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  set weight of a variable label, in both tables (used to 
+  ///  seed the problem before solving it)
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  void problem::set_label_weight(int i, int j, double w) {
+    label &lb = labels[vars[i][j]];
+    lb.weight[CURRENT] = lb.weight[NEXT] = w;
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  pin weights of a variable, so the solver will not change them
+  ///  (e.g. variables shared with an already solved neighbour problem)
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  void problem::fix_variable(int i) {
+    fixed[i] = true;
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  check whether a variable is pinned
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  bool problem::is_fixed(int i) const {
+    return fixed[i];
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  get number of constraints in the problem
+  ///
+  ///////////////////////////////////////////////////////////////
+
+  int problem::get_num_constraints() const {
+    return constraints.size();
+  }
+
+  ///////////////////////////////////////////////////////////////
+  ///
+  ///  Add a label (and its weight) to the i-th variable.
+  ///  Label slots beyond num_labels are reused if available.
   ///
   ///////////////////////////////////////////////////////////////
 
   void problem::add_label(int i, double w, const string &lbname) {
-    label lb;
+    if (num_labels == int(labels.size())) append(labels, label());
+
+    label &lb = labels[num_labels];
     lb.weight[CURRENT] = lb.weight[NEXT] = w;
+    if (lb.name.capacity() < lbname.size()) ++growths;
     lb.name = lbname;
-    vars[i].push_back(lb);
+    lb.first_ct = lb.last_ct = -1;
+    lb.pruned = false;
+
+    append(vars[i], num_labels);
+    num_labels++;
   }
 
 
+  ////////////////////////////////////////////////
+  ///  Create a new constraint with nt terms for (v,l), 
+  /// and add it at the end of the label constraint list.
+  /// Terms are left empty, to be filled by the caller.
+  ////////////////////////////////////////////////
+
+  void problem::new_constraint(int v, int l, int nt, double comp) {
+    label &lb = labels[vars[v][l]];
+    int c = constraints.size();
+    append(constraints, constraint(comp, terms.size(), nt));
+    if (lb.last_ct<0) lb.first_ct = c;
+    else constraints[lb.last_ct].next = c;
+    lb.last_ct = c;
+  }
+
   ////////////////////////////////////////////////
   ///  Add a new constraint to the problem, afecting 
   /// the (v,l) pair
@@ -114,28 +261,47 @@ using namespace std;
 
   void problem::add_constraint(int v, int l, const list<list<pair<int,int> > > &lp, double comp) {
 
-    constraint ct(lp.size());
-
-    // translate the given list of coordinates (v,l) to pointers
-    // to the actual label weights, to speed later access.
-    list<list<pair<int,int> > >::const_iterator x;
-    int i;
-    for (i=0,x=lp.begin();  x!=lp.end();  i++,x++) {
-
-      ct[i] = vector<constraint_element>(x->size());
-                            
-      list<pair<int,int> >::const_iterator y;
-      int j;
-      for (j=0,y=x->begin();  y!=x->end();  j++,y++) {
-        TRACE(4, "added constraint with comp=" << comp << " for ("<<v<<","<<l<<")["<<varnames[v]<<"="<<vars[v][l].get_name()
-              << "] <== (" << y->first << "," << y->second << ")["<<varnames[y->first]<<"="<<vars[y->first][y->second].get_name()<<"]");
-        
-        ct[i][j] = constraint_element(y->first, y->second, vars[y->first][y->second].weight);
+    new_constraint(v, l, lp.size(), comp);
+
+    // translate the given list of coordinates (v,l) to positions
+    // in the label table, to speed later access.
+    for (auto &x : lp) {
+      append(terms, make_pair(int(elements.size()), int(x.size())));
+      for (auto &y : x) {
+        TRACE(4, "added constraint with comp=" << comp << " for ("<<v<<","<<l<<")["<<varnames[v]<<"="<<get_label_name(v,l)
+              << "] <== (" << y.first << "," << y.second << ")["<<varnames[y.first]<<"="<<get_label_name(y.first,y.second)<<"]");
+        append(elements, vars[y.first][y.second]);
       }
     }
+  }
+
+  ////////////////////////////////////////////////
+  ///  Add a new constraint with a single element (v1,l1)
+  /// to the problem, afecting the (v,l) pair
+  ////////////////////////////////////////////////
+
+  void problem::add_constraint(int v, int l, int v1, int l1, double comp) {
+    TRACE(4, "added constraint with comp=" << comp << " for ("<<v<<","<<l<<")["<<varnames[v]<<"="<<get_label_name(v,l)
+          << "] <== (" << v1 << "," << l1 << ")["<<varnames[v1]<<"="<<get_label_name(v1,l1)<<"]");
+    new_constraint(v, l, 1, comp);
+    append(terms, make_pair(int(elements.size()), 1));
+    append(elements, vars[v1][l1]);
+  }
+
+  ////////////////////////////////////////////////
+  ///  Add a new constraint with two single-element terms
+  /// (v1,l1)*(v2,l2) to the problem, afecting the (v,l) pair
+  ////////////////////////////////////////////////
 
-    ct.set_compatibility(comp);
-    vars[v][l].constraints.push_back(ct);
+  void problem::add_constraint(int v, int l, int v1, int l1, int v2, int l2, double comp) {
+    TRACE(4, "added constraint with comp=" << comp << " for ("<<v<<","<<l<<")["<<varnames[v]<<"="<<get_label_name(v,l)
+          << "] <== (" << v1 << "," << l1 << ")["<<varnames[v1]<<"="<<get_label_name(v1,l1)<<"]"
+          << " * (" << v2 << "," << l2 << ")["<<varnames[v2]<<"="<<get_label_name(v2,l2)<<"]");
+    new_constraint(v, l, 2, comp);
+    append(terms, make_pair(int(elements.size()), 1));
+    append(elements, vars[v1][l1]);
+    append(terms, make_pair(int(elements.size()), 1));
+    append(elements, vars[v2][l2]);
   }
 
   ////////////////////////////////////////////////
@@ -145,22 +311,20 @@ using namespace std;
   ////////////////////////////////////////////////
 
   list<int> problem::best_label(int v) const {
-    vector<label>::const_iterator lab;
-    int j;
     double max;
     list<int> best;
 
     // build list of labels with highest weight
     max=0.0; 
-    for (j=0,lab=vars[v].begin(); lab!=vars[v].end(); j++,lab++) {
-
-      if (lab->weight[CURRENT] > max) {
-        max=lab->weight[CURRENT];
+    for (size_t j=0; j<vars[v].size(); j++) {
+      double w = labels[vars[v][j]].weight[CURRENT];
+      if (w > max) {
+        max=w;
         // if new maximum, restart list from scratch
         best.clear();
         best.push_back(j);
       }
-      else if (lab->weight[CURRENT] == max) {
+      else if (w == max) {
         // if equals current maximum, add to the list.
         best.push_back(j);
       }
@@ -175,13 +339,10 @@ using namespace std;
   ////////////////////////////////////////////////
 
   bool problem::there_are_changes(double epsil) const {
-    vector<vector<label> >::const_iterator i;
-    vector<label>::const_iterator j;
-
-    for (i=vars.begin(); i!=vars.end(); i++) 
-      if (i->size() > 1) 
-        for (j=i->begin(); j!=i->end(); j++) {
-          double ch = fabs(j->weight[NEXT] - j->weight[CURRENT]);
+    for (int v=0; v<num_vars; v++) 
+      if (vars[v].size() > 1) 
+        for (auto j : vars[v]) {
+          double ch = fabs(labels[j].weight[NEXT] - labels[j].weight[CURRENT]);
           if (ch >= epsil) {
             TRACE(4," Found weight change of " << ch << ", not converging yet.");
             return true;
@@ -191,6 +352,84 @@ using namespace std;
     return(false);
   }
 
+  ////////////////////////////////////////////////
+  /// Remove labels whose current weight fell below given floor,
+  /// together with any constraint element pointing to them.
+  /// Variables are compacted in place, and remaining weights 
+  /// renormalized. The best label of each variable is never removed.
+  /// Returns the number of pruned labels.
+  ////////////////////////////////////////////////
+
+  int problem::prune_labels(double floor) {
+
+    int pruned=0;
+    for (int v=0; v<num_vars; v++) {
+      // pinned variables are left untouched
+      if (fixed[v] or vars[v].size()<2) continue;
+
+      size_t best=0;
+      for (size_t j=1; j<vars[v].size(); j++) 
+        if (labels[vars[v][j]].weight[CURRENT] > labels[vars[v][best]].weight[CURRENT]) best=j;
+
+      // compact variable, keeping surviving labels in order
+      double sum=0;
+      size_t k=0;
+      for (size_t j=0; j<vars[v].size(); j++) {
+        label &lb = labels[vars[v][j]];
+        if (j!=best and lb.weight[CURRENT] < floor) {
+          TRACE(3,"Pruning label ("<<v<<","<<j<<")["<<varnames[v]<<"="<<lb.get_name()<<"] weight=" << lb.weight[CURRENT]);
+          lb.pruned = true;
+          pruned++;
+        }
+        else {
+          sum += lb.weight[CURRENT];
+          vars[v][k++] = vars[v][j];
+        }
+      }
+      if (k==vars[v].size()) continue;
+      vars[v].resize(k);
+
+      // renormalize remaining weights so they still add up to one
+      if (sum>0) 
+        for (auto j : vars[v]) 
+          labels[j].weight[CURRENT] = labels[j].weight[NEXT] = labels[j].weight[CURRENT]/sum;
+    }
+
+    if (pruned==0) return 0;
+
+    // drop elements pointing to pruned labels. A term left empty 
+    // makes the whole product null, so the constraint is removed.
+    for (int v=0; v<num_vars; v++) {
+      for (auto j : vars[v]) {
+        label &lb = labels[j];
+        int prev=-1;
+        for (int r=lb.first_ct; r>=0; r=constraints[r].next) {
+          constraint &ct = constraints[r];
+          bool useless=false;
+          for (int t=ct.first_term; t<ct.first_term+ct.num_terms; t++) {
+            int first = terms[t].first;
+            int k=first;
+            for (int e=first; e<first+terms[t].second; e++) 
+              if (not labels[elements[e]].pruned) elements[k++] = elements[e];
+            terms[t].second = k-first;
+            useless = useless or terms[t].second==0;
+          }
+
+          if (not useless) prev = r;
+          else {
+            // unlink constraint from label list
+            if (prev<0) lb.first_ct = ct.next;
+            else constraints[prev].next = ct.next;
+            if (lb.last_ct==r) lb.last_ct = prev;
+          }
+        }
+      }
+    }
+
+    TRACE(2,"Pruned "<<pruned<<" labels");
+    return pruned;
+  }
+
   ////////////////////////////////////////////////
   /// Exchange tables, get ready for next iteration
   ////////////////////////////////////////////////
@@ -200,6 +439,13 @@ using namespace std;
     NEXT = 1 - NEXT;    // 'NEXT' becomes 'CURRENT'. A new 'NEXT' will be computed
   }
 
+  ////////////////////////////////////////////////
+  /// Pool statistics: number of resets and table growths
+  ////////////////////////////////////////////////
+
+  long problem::get_resets() const { return resets; }
+  long problem::get_growths() const { return growths; }
+
   //---------- Class label ----------------------------------
 
   ////////////////////////////////////////////////////////////////
@@ -207,22 +453,20 @@ using namespace std;
   /// variable label in the relaxation labelling algorithm.
   ////////////////////////////////////////////////////////////////
 
-  label::label() {}
+  label::label() : first_ct(-1), last_ct(-1), pruned(false) { weight[0]=weight[1]=0; }
   double label::get_weight(int which) const { return weight[which]; }
   void label::set_weight(int which, double w) { weight[which]=w; }
   string label::get_name() const { return name; }
 
   //---------- Class constraint ----------------------------------
 
-  constraint_element::constraint_element() {var=-1; lab=-1; w=NULL;}
-  constraint_element::constraint_element(int v, int l, double* wgh) {var=v; lab=l; w=wgh;}
-
   ////////////////////////////////////////////////////////////////
   ///  The class constraint stores all information related to a 
   /// constraint on a label in the relaxation labelling algorithm.
   ////////////////////////////////////////////////////////////////
 
-  constraint::constraint(int sz) :  vector<vector<constraint_element> >(sz, vector<constraint_element>()) {}
+  constraint::constraint() : compatibility(0), first_term(0), num_terms(0), next(-1) {}
+  constraint::constraint(double c, int ft, int nt) : compatibility(c), first_term(ft), num_terms(nt), next(-1) {}
 
   ////////////////////////////////////////////////
   /// set compatibility value
@@ -241,13 +485,276 @@ using namespace std;
   }
 
 
+  //---------- Class problem_batch ----------------------------------
+
+  ////////////////////////////////////////////////////////////////
+  ///  Constructor: create an empty batch
+  ////////////////////////////////////////////////////////////////
+
+  problem_batch::problem_batch() {
+    clear();
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Empty the batch. Tables keep their memory for reuse.
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::clear() {
+    problems.clear();
+    weight[0].clear(); weight[1].clear();
+    var_first.clear(); var_problem.clear(); var_fixed.clear();
+    lab_first.clear(); compat.clear(); ct_first.clear();
+    term_first.clear(); elem.clear(); prb_first.clear();
+    iterations.clear(); converged.clear();
+    placing = false;
+
+    var_first.push_back(0);
+    lab_first.push_back(0);
+    ct_first.push_back(0);
+    term_first.push_back(0);
+    prb_first.push_back(0);
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Pack a problem at the end of the batch tables. Constraint 
+  ///  elements are translated from label table positions to
+  ///  positions in the batch weight table.
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::add(problem &prb) {
+    add_labels(prb);
+
+    // constraints
+    for (int v=0; v<prb.num_vars; v++) {
+      for (auto j : prb.vars[v]) {
+        for (int r=prb.labels[j].first_ct; r>=0; r=prb.constraints[r].next) {
+          const constraint &ct = prb.constraints[r];
+          for (int t=ct.first_term; t<ct.first_term+ct.num_terms; t++) {
+            for (int e=prb.terms[t].first; e<prb.terms[t].first+prb.terms[t].second; e++) 
+              elem.push_back(label_pos[prb.elements[e]]);
+            term_first.push_back(elem.size());
+          }
+          compat.push_back(ct.get_compatibility());
+          ct_first.push_back(term_first.size()-1);
+        }
+        lab_first.push_back(compat.size());
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Pack the variables and labels of a problem at the end of the
+  ///  batch tables, keeping the batch position of each label.
+  ///  Constraints of the problem tables are ignored.
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::add_labels(problem &prb) {
+    int p = problems.size();
+    problems.push_back(&prb);
+    iterations.push_back(0);
+    converged.push_back(false);
+
+    label_base = weight[0].size();
+    if (int(label_pos.size()) < prb.num_labels) label_pos.resize(prb.num_labels);
+    for (int v=0; v<prb.num_vars; v++) {
+      for (auto j : prb.vars[v]) {
+        label_pos[j] = weight[0].size();
+        weight[0].push_back(prb.labels[j].weight[prb.CURRENT]);
+        weight[1].push_back(prb.labels[j].weight[prb.CURRENT]);
+      }
+      var_first.push_back(weight[0].size());
+      var_problem.push_back(p);
+      var_fixed.push_back(prb.fixed[v]);
+    }
+    prb_first.push_back(var_first.size()-1);
+
+    int nl = weight[0].size()-label_base;
+    ct_count.assign(nl, 0);
+    tm_count.assign(nl, 0);
+    placing = false;
+
+    TRACE(3,"Packed problem "<<p<<" with "<<nl<<" labels");
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Reserve room for the constraints counted for the last problem.
+  ///  The constraints of each label are contiguous, in the order they
+  ///  are added, as if they were packed from the problem tables.
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::place_constraints() {
+    int c = compat.size();
+    int t = term_first.size()-1;
+    term_base = t;
+    elem_base = elem.size();
+    for (size_t i=0; i<ct_count.size(); i++) {
+      int nc = ct_count[i], nt = tm_count[i];
+      ct_count[i] = c;
+      tm_count[i] = t;
+      c += nc;
+      t += nt;
+      lab_first.push_back(c);
+    }
+    compat.resize(c);
+    ct_first.resize(c+1);
+    term_first.resize(t+1);
+    elem.resize(elem_base+t-term_base);
+    placing = true;
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Store a one-element term of the last problem, referring
+  ///  to the label at given batch position
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::place_term(int t, int pos) {
+    int e = elem_base+t-term_base;
+    elem[e] = pos;
+    term_first[t+1] = e+1;
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Count or store a constraint with a single element (v1,l1)
+  ///  of the last problem, afecting the (v,l) pair
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::add_constraint(int v, int l, int v1, int l1, double comp) {
+    const problem &prb = *problems.back();
+    int i = label_pos[prb.vars[v][l]]-label_base;
+    if (not placing) {
+      ct_count[i]++;
+      tm_count[i]++;
+      return;
+    }
+
+    int c = ct_count[i]++;
+    int t = tm_count[i]++;
+    compat[c] = comp;
+    ct_first[c+1] = t+1;
+    place_term(t, label_pos[prb.vars[v1][l1]]);
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Count or store a constraint with two single-element terms
+  ///  (v1,l1)*(v2,l2) of the last problem, afecting the (v,l) pair
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::add_constraint(int v, int l, int v1, int l1, int v2, int l2, double comp) {
+    const problem &prb = *problems.back();
+    int i = label_pos[prb.vars[v][l]]-label_base;
+    if (not placing) {
+      ct_count[i]++;
+      tm_count[i] += 2;
+      return;
+    }
+
+    int c = ct_count[i]++;
+    int t = tm_count[i];
+    tm_count[i] += 2;
+    compat[c] = comp;
+    ct_first[c+1] = t+2;
+    place_term(t, label_pos[prb.vars[v1][l1]]);
+    place_term(t+1, label_pos[prb.vars[v2][l2]]);
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  Prune labels of the p-th problem as problem::prune_labels 
+  ///  does, using the weights in the given table. Pruned labels
+  ///  get a null weight in both tables, so they add nothing to the
+  ///  constraints referring them and are skipped from then on,
+  ///  which gives the same weights as removing them.
+  ////////////////////////////////////////////////////////////////
+
+  int problem_batch::prune_labels(int p, int table, double floor) {
+    vector<double> &w = weight[table];
+    vector<double> &w2 = weight[1-table];
+
+    int npruned=0;
+    for (int v=prb_first[p]; v<prb_first[p+1]; v++) {
+      int first = var_first[v];
+      int last = var_first[v+1];
+      if (var_fixed[v] or last-first<2) continue;
+
+      // labels still alive, and the best of them
+      int best=-1, alive=0;
+      for (int j=first; j<last; j++) {
+        if (pruned[j]) continue;
+        ++alive;
+        if (best<0 or w[j]>w[best]) best=j;
+      }
+      if (alive<2) continue;
+
+      double sum=0;
+      bool any=false;
+      for (int j=first; j<last; j++) {
+        if (pruned[j]) continue;
+        if (j!=best and w[j]<floor) {
+          TRACE(3,"Pruning label "<<j<<" of batch problem "<<p<<" weight="<<w[j]);
+          pruned[j] = true;
+          w[j] = w2[j] = 0;
+          any = true;
+          npruned++;
+        }
+        else sum += w[j];
+      }
+
+      // renormalize remaining weights so they still add up to one
+      if (any and sum>0) 
+        for (int j=first; j<last; j++) 
+          if (not pruned[j]) w[j] = w2[j] = w[j]/sum;
+    }
+
+    if (npruned>0) { TRACE(2,"Pruned "<<npruned<<" labels of batch problem "<<p); }
+    return npruned;
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  number of problems in the batch
+  ////////////////////////////////////////////////////////////////
+
+  int problem_batch::size() const {
+    return problems.size();
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  iterations used to solve the i-th problem
+  ////////////////////////////////////////////////////////////////
+
+  int problem_batch::get_iterations(int i) const {
+    return iterations[i];
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  number of constraints of the i-th problem
+  ////////////////////////////////////////////////////////////////
+
+  int problem_batch::get_num_constraints(int i) const {
+    return lab_first[var_first[prb_first[i+1]]] - lab_first[var_first[prb_first[i]]];
+  }
+
+  ////////////////////////////////////////////////////////////////
+  ///  copy solved weights back to the original problems. 
+  ///  Converged problems have the same weights in both tables.
+  ////////////////////////////////////////////////////////////////
+
+  void problem_batch::unpack() const {
+    int k=0;
+    for (auto prb : problems) 
+      for (int v=0; v<prb->num_vars; v++) 
+        for (auto j : prb->vars[v]) {
+          prb->labels[j].weight[0] = prb->labels[j].weight[1] = weight[0][k];
+          k++;
+        }
+  }
+
+
   //---------- Class relax ----------------------------------
 
   ///////////////////////////////////////////////////////////////
   ///  Constructor: Build a relax solver
   ///////////////////////////////////////////////////////////////
 
-  relax::relax(int m, double f, double r) : MaxIter(m), ScaleFactor(f), Epsilon(r) {}
+  relax::relax(int m, double f, double r, double p) : MaxIter(m), ScaleFactor(f), Epsilon(r), PruneFloor(p) {}
 
 
   ////////////////////////////////////////////////
@@ -258,76 +765,88 @@ using namespace std;
 
 
   ////////////////////////////////////////////////
-  /// Solve the consistent labelling problem
+  /// Solve the consistent labelling problem.
+  /// Return the number of iterations performed
   ////////////////////////////////////////////////
 
-  void relax::solve(problem &prb) const {
+  int relax::solve(problem &prb) const {
   
+    timeline::scope ts("solve", prb.num_vars);
+    // support table is kept in the problem, so it is allocated only once
+    size_t maxl=0;
+    for (int v=0; v<prb.num_vars; v++) maxl = std::max(maxl, prb.vars[v].size());
+    if (prb.support.size() < maxl) {
+      ++prb.growths;
+      prb.support.resize(maxl);
+    }
+    double *support = prb.support.data();
+
     // iterate until convercence (no changes)
     int n=0; 
-    double change;
+    double change=0;
     int vch=0;
     int jch=0;
     while ((n==0 or change>=Epsilon) and n<MaxIter) {
       TRACE(1,"Relaxation iteration number "<<n);
       TRACE(2," Max abs change is "<<change
             <<" (v,l)=("<<vch<<","<<jch<<")["<<prb.get_var_name(vch)<<":"<<prb.get_label_name(vch,jch)<<"]"
-            <<" from "<<prb.vars[vch][jch].get_weight(prb.NEXT)
-            <<" to "<<prb.vars[vch][jch].get_weight(prb.CURRENT));
+            <<" from "<<prb.labels[prb.vars[vch][jch]].get_weight(prb.NEXT)
+            <<" to "<<prb.labels[prb.vars[vch][jch]].get_weight(prb.CURRENT));
 
       change=0;
 
       // for each label of each variable
-      vector<vector<label> >::iterator var;
-      int v;
-      for (v=0,var=prb.vars.begin(); var!=prb.vars.end(); var++,v++) {
+      for (int v=0; v<prb.num_vars; v++) {
+        const vector<int> &var = prb.vars[v];
 
         TRACE(3,"   Variable " << v << " (" << prb.get_var_name(v) << ")");
         double fnorm=0;
 
         // variable has only one or no labels. No need to change anything
-        if (var->size() == 0) {
+        if (var.size() == 0) {
           TRACE(4,"     No labels");
         }
-        else if (var->size() == 1) {
-          TRACE(4,"     Label 0 (" << prb.get_label_name(v,0) << ")" << " weight=" << (*var)[0].get_weight(prb.CURRENT));          
+        else if (var.size() == 1) {
+          TRACE(4,"     Label 0 (" << prb.get_label_name(v,0) << ")" << " weight=" << prb.labels[var[0]].get_weight(prb.CURRENT));          
+        }
+        else if (prb.fixed[v]) {
+          // variable pinned by the caller. Keep its weights in both tables
+          TRACE(4,"     Fixed variable");
+          for (auto j : var) prb.labels[j].set_weight(prb.NEXT, prb.labels[j].get_weight(prb.CURRENT));
         }
         
         else { //  Variable has more than one option, apply constraints to update weights
         
-          double *support = new double[var->size()];
-          vector<label>::iterator lab;
-          int j;
-          for (j=0,lab=var->begin(); lab!=var->end();  j++,lab++) {
+          for (size_t j=0; j<var.size(); j++) {
+            const label &lab = prb.labels[var[j]];
 
-            double CurrW = lab->get_weight(prb.CURRENT);
+            double CurrW = lab.get_weight(prb.CURRENT);
             TRACE(4,"     Label " << j << " (" << prb.get_label_name(v,j) << ")" << " weight=" << CurrW);
             if (CurrW>0) { // if weight==0 don't bother to compute supports, since the weight won't change
             
               support[j]=0.0;
               // apply each constraint affecting the label
-              list<constraint>::const_iterator r;
-              for (r=lab->constraints.begin(); r!=lab->constraints.end(); r++) {
-		TRACE(6,"      -Checking constraint (comp:" << r->get_compatibility() << ")");
+              for (int r=lab.first_ct; r>=0; r=prb.constraints[r].next) {
+                const constraint &ct = prb.constraints[r];
+		TRACE(6,"      -Checking constraint (comp:" << ct.get_compatibility() << ")");
 
                 // each constraint is a list of terms to be multiplied
-                constraint::const_iterator p;
                 double inf = 1.0;
-                for (p=r->begin(); p!=r->end(); p++) {
+                for (int t=ct.first_term; t<ct.first_term+ct.num_terms; t++) {
 		  // each term is a list (of lenght one except on negative or wildcarded conditions) 
                   // of label weights to be added.
-                  double tw;
-                  vector<constraint_element>::const_iterator wg;
-                  for (tw=0, wg=p->begin(); wg!=p->end(); wg++) {
-                    tw += (wg->w)[prb.CURRENT];
-		    TRACE(6,"         adding constraint element (" << wg->var << "," << wg->lab << "," << (wg->w)[prb.CURRENT] << ")");
+                  double tw=0;
+                  int first = prb.terms[t].first;
+                  for (int e=first; e<first+prb.terms[t].second; e++) {
+                    tw += prb.labels[prb.elements[e]].weight[prb.CURRENT];
+		    TRACE(6,"         adding constraint element (" << prb.elements[e] << "," << prb.labels[prb.elements[e]].weight[prb.CURRENT] << ")");
 		  }
                   inf *= tw;
                 }
               
                 // add constraint influence*compatibility to label support
-                support[j] += r->get_compatibility() * inf;
-                TRACE(6,"       constraint done (comp:" << r->get_compatibility() << "), inf=" << inf << ",  accum.support=" << support[j]);
+                support[j] += ct.get_compatibility() * inf;
+                TRACE(6,"       constraint done (comp:" << ct.get_compatibility() << "), inf=" << inf << ",  accum.support=" << support[j]);
               }
             
               // normalize supports to a unified range
@@ -340,28 +859,121 @@ using namespace std;
           }
         
           // update label weigths, update maximum seen change
-          for (j=0,lab=var->begin(); lab!=var->end();  j++,lab++) {
-            double CurrW = lab->get_weight(prb.CURRENT);
+          for (size_t j=0; j<var.size(); j++) {
+            label &lab = prb.labels[var[j]];
+            double CurrW = lab.get_weight(prb.CURRENT);
             double NewW = (CurrW>0 ? CurrW*(1+support[j])/fnorm : 0);
-            lab->set_weight(prb.NEXT, NewW);
+            lab.set_weight(prb.NEXT, NewW);
             if (fabs(NewW-CurrW) > change) {
               change = fabs(NewW-CurrW);
               vch=v; jch=j;
             }
           }
-        
-          delete[] support;
         }
       }
     
       n++; 
 
       prb.next_iteration();  // exchange tables to prepare for next iteration
+
+      // get rid of labels that are not going to win, so next iterations don't visit them
+      if (PruneFloor>0 and prb.prune_labels(PruneFloor)>0) jch=0;  // traced label may be gone
     }
+
+    return n;
   }
 
 
+  ////////////////////////////////////////////////
+  /// Solve a batch of problems in lockstep. 
+  /// Each iteration updates all variables of problems not 
+  /// converged yet. A problem converges under the same conditions
+  /// than in solve(problem&), and its weights are then copied
+  /// to both tables so they stay put in later iterations.
+  ////////////////////////////////////////////////
+
+  void relax::solve(problem_batch &b) const {
+
+    timeline::scope ts("solve batch", b.size());
+    int CURRENT=0, NEXT=1;
+    int nprb = b.size();
+    int active = nprb;
+    // max change and label supports, allocated once for the whole batch
+    vector<double> &change = b.change;
+    vector<double> &support = b.support;
+    change.resize(nprb);
+    support.resize(b.weight[0].size());
+    b.pruned.assign(b.weight[0].size(), false);
+
+    if (MaxIter<=0) return;  // nothing to do, weights are already in place
+    
+    while (active>0) {
+      for (int p=0; p<nprb; p++) change[p]=0;
+
+      for (int p=0; p<nprb; p++) {
+        if (b.converged[p]) continue;
+
+        const double *cw = b.weight[CURRENT].data();
+        double *nw = b.weight[NEXT].data();
+
+        for (int v=b.prb_first[p]; v<b.prb_first[p+1]; v++) {
+          int first = b.var_first[v];
+          int last = b.var_first[v+1];
+          // fixed variables or variables with just one label keep their weights
+          if (b.var_fixed[v] or last-first<=1) {
+            for (int j=first; j<last; j++) nw[j] = cw[j];
+            continue;
+          }
+
+          double fnorm=0;
+          for (int j=first; j<last; j++) {
+            if (cw[j]<=0) continue;  // null weights won't change, skip them
+
+            double sup=0;
+            for (int r=b.lab_first[j]; r<b.lab_first[j+1]; r++) {
+              double inf=1.0;
+              for (int t=b.ct_first[r]; t<b.ct_first[r+1]; t++) {
+                double tw=0;
+                for (int e=b.term_first[t]; e<b.term_first[t+1]; e++) tw += cw[b.elem[e]];
+                inf *= tw;
+              }
+              sup += b.compat[r]*inf;
+            }
+            support[j] = NormalizeSupport(sup);
+            fnorm += cw[j]*(1+support[j]);
+          }
+
+          for (int j=first; j<last; j++) {
+            double NewW = (cw[j]>0 ? cw[j]*(1+support[j])/fnorm : 0);
+            nw[j] = NewW;
+            if (fabs(NewW-cw[j]) > change[p]) change[p] = fabs(NewW-cw[j]);
+          }
+        }
+      }
+
+      // check convergence of each problem still running, after pruning labels
+      // of its new weights as solve(problem&) does at the end of each iteration
+      for (int p=0; p<nprb; p++) {
+        if (b.converged[p]) continue;
+        if (PruneFloor>0) b.prune_labels(p, NEXT, PruneFloor);
+        b.iterations[p]++;
+        if (change[p]<Epsilon or b.iterations[p]>=MaxIter) {
+          TRACE(2,"Batch problem "<<p<<" converged after "<<b.iterations[p]<<" iterations");
+          b.converged[p] = true;
+          active--;
+          for (int j=b.var_first[b.prb_first[p]]; j<b.var_first[b.prb_first[p+1]]; j++)
+            b.weight[CURRENT][j] = b.weight[NEXT][j];
+        }
+      }
+
+      // exchange tables
+      CURRENT = NEXT;
+      NEXT = 1-NEXT;
+    }
 
+    // leave final weights in table 0, where unpack expects them
+    if (CURRENT==1) b.weight[0].swap(b.weight[1]);
+  }
 
 
   //--------------- private methods -------------
@@ -32,29 +32,31 @@
 #include <list>
 #include <vector>
 
-  class constraint_element {
-  public:
-    constraint_element();
-    constraint_element(int, int, double*);
-    int var,lab; // target (var,lab) --used for tracing mainly
-    double *w;   // pointer to (var,lab) weigth in problem matrix.
-  };
- 
-  
   ////////////////////////////////////////////////////////////////
   ///
   ///  The class constraint implements a constraint for the 
-  /// relaxation labelling algorithm.
+  /// relaxation labelling algorithm. It is a product of terms,
+  /// each of them a sum of label weights. Terms and elements
+  /// are stored in the problem tables.
   ///
   ////////////////////////////////////////////////////////////////
 
-  class constraint : public std::vector<std::vector<constraint_element> > {
+  class constraint {
+    friend class problem;
+    friend class problem_batch;
+    friend class relax;
+
   private:
     double compatibility;
+    /// first term of the constraint in problem term table, and number of terms
+    int first_term, num_terms;
+    /// next constraint on the same label (-1 if none)
+    int next;
 
   public:
     /// Constructor
-    constraint(int);
+    constraint();
+    constraint(double, int, int);
 
     /// set/get compatibility value
     void set_compatibility(double);
@@ -70,6 +72,7 @@
 
   class label {
     friend class problem;
+    friend class problem_batch;
     friend class relax;
 
   protected:
@@ -77,8 +80,10 @@
     double weight[2];
     /// label name, for user convenience
     std::string name;
-    /// list of constraints for the label
-    std::list<constraint> constraints;
+    /// list of constraints for the label (positions in problem constraint table, -1 if empty)
+    int first_ct, last_ct;
+    /// whether the label was pruned by the solver
+    bool pruned;
 
   public:
     /// Constructor
@@ -98,23 +103,56 @@
   ///   Variables and labels are unnamed, and sequentially 
   ///  numbered. The caller application must keep track of 
   ///  the meaning of each variable and label position.
+  ///   All data is kept in pooled tables that are not released 
+  ///  by reset(), so a problem object can be reused for many
+  ///  problems without further memory allocation once its tables
+  ///  have grown to the needed size.
   ///
   ////////////////////////////////////////////////////////////////
 
   class problem {
     friend class relax;
+    friend class problem_batch;
   protected:
-    /// table with variable-labels in the CLP.
-    std::vector<std::vector<label> > vars;
+    /// number of variables in use (tables below may be larger)
+    int num_vars;
+    /// labels of each variable (positions in label table)
+    std::vector<std::vector<int> > vars;
     /// variable names, for user convenience
     std::vector<std::string> varnames;
+    /// variables whose weights must not be changed by the solver
+    std::vector<bool> fixed;
+    /// label table, and number of labels in use
+    std::vector<label> labels;
+    int num_labels;
+    /// constraint table
+    std::vector<constraint> constraints;
+    /// constraint terms: (first element, number of elements) in element table
+    std::vector<std::pair<int,int> > terms;
+    /// constraint elements: label whose weight is added to the term
+    std::vector<int> elements;
+    /// label supports, scratch space for the solver
+    std::vector<double> support;
     /// which of both weight sets are we using and which are we computing
     int CURRENT, NEXT;
+    /// pool statistics: times the problem was reset, and times a table had to grow
+    long resets, growths;
+
+    /// append an item to a pool table, counting table growths
+    template <class T> void append(std::vector<T> &, const T &);
+    /// create a constraint with given number of terms for (v,l)
+    void new_constraint(int, int, int, double);
 
   public:
     /// Constructor
-    problem(int);
+    problem(int nv=0);
 
+    /// empty the problem to reuse it with nv variables, keeping allocated tables
+    void reset(int nv);
+    /// add a variable with no labels at the end of the problem. Returns its position
+    int add_variable(const std::string &);
+    /// get number of variables
+    int get_num_vars() const;
     /// set variable name 
     void set_var_name(int, const std::string &);
     /// get variable name
@@ -123,19 +161,121 @@
     int get_num_labels(int i) const;
     /// get label name
     std::string get_label_name(int i, int j) const;
+    /// get current label weight
+    double get_label_weight(int i, int j) const;
+    /// set label weight (e.g. to seed it before solving)
+    void set_label_weight(int i, int j, double w);
+    /// pin the weights of a variable, so the solver will not change them
+    void fix_variable(int i);
+    /// check whether a variable is pinned
+    bool is_fixed(int i) const;
+    /// get number of constraints
+    int get_num_constraints() const;
 
     /// add a label and its weight (and its name if needed) to the given variable
     void add_label(int, double, const std::string &lb="");
     /// add a new constraint to the problem
     void add_constraint (int, int, const std::list<std::list<std::pair<int,int> > > &, double);
+    /// add a new constraint with a single term of one element (no allocation needed)
+    void add_constraint (int, int, int, int, double);
+    /// add a new constraint with two terms of one element each (no allocation needed)
+    void add_constraint (int, int, int, int, int, int, double);
     /// get best label(s) --hopefully only one-- for given variable
     std::list<int> best_label(int) const;
     /// check whether convergence was achieved
     bool there_are_changes(double) const;
+    /// remove labels (and constraints referring them) with weight below given floor
+    int prune_labels(double);
     /// Exchange tables, get ready for next iteration
     void next_iteration();
+
+    /// pool statistics
+    long get_resets() const;
+    long get_growths() const;
   };
 
+  ////////////////////////////////////////////////////////////////
+  ///
+  ///  The class problem_batch packs several small problems into
+  ///  contiguous structure-of-arrays tables, so they can be solved
+  ///  together in lockstep without per-problem allocations. 
+  ///  Each problem keeps its own convergence status.
+  ///  Weights are written back to the original problems by unpack().
+  ///   Constraints may be copied from the problem, or added
+  ///  directly into the batch tables (see add_labels).
+  ///
+  ////////////////////////////////////////////////////////////////
+
+  class problem_batch {
+    friend class relax;
+  private:
+    /// packed problems
+    std::vector<problem*> problems;
+    /// label weights at current and next iteration, for all labels in the batch
+    std::vector<double> weight[2];
+    /// first label of each variable (plus a sentinel), and problem owning the variable
+    std::vector<int> var_first, var_problem;
+    /// variables pinned by the caller
+    std::vector<bool> var_fixed;
+    /// first constraint of each label (plus a sentinel)
+    std::vector<int> lab_first;
+    /// constraint compatibilities and first term of each constraint (plus a sentinel)
+    std::vector<double> compat;
+    std::vector<int> ct_first;
+    /// first element of each term (plus a sentinel)
+    std::vector<int> term_first;
+    /// weight position referred by each constraint element
+    std::vector<int> elem;
+    /// first variable of each problem (plus a sentinel)
+    std::vector<int> prb_first;
+    /// iterations performed by each problem, and whether it has converged
+    std::vector<int> iterations;
+    std::vector<bool> converged;
+    /// scratch space for the solver: max change of each problem and label supports
+    std::vector<double> change, support;
+    /// labels pruned by the solver
+    std::vector<bool> pruned;
+    /// batch weight position of each label of the last added problem
+    std::vector<int> label_pos;
+    /// constraints added directly for the last problem: whether their room is already
+    /// reserved, and for each of its labels, their constraint and term count (while counting)
+    /// or next free constraint and term (while placing)
+    bool placing;
+    std::vector<int> ct_count, tm_count;
+    /// first weight, term and element of the last problem
+    int label_base, term_base, elem_base;
+
+    /// store a one-element term at given position
+    void place_term(int, int);
+    /// prune labels of the p-th problem with weight below given floor in the given table
+    int prune_labels(int, int, double);
+
+  public:
+    /// Constructor
+    problem_batch();
+    /// empty the batch, keeping allocated tables for reuse
+    void clear();
+    /// add a problem to the batch. The problem must outlive the batch.
+    void add(problem &);
+    /// add the variables and labels of a problem with no constraints to the batch.
+    /// Its constraints are then given to add_constraint twice, in the same order: 
+    /// first to count them, and after place_constraints, to store them.
+    void add_labels(problem &);
+    /// reserve room for the constraints counted for the last problem
+    void place_constraints();
+    /// add a constraint with a single term of one element to the last problem
+    void add_constraint(int, int, int, int, double);
+    /// add a constraint with two terms of one element each to the last problem
+    void add_constraint(int, int, int, int, int, int, double);
+    /// number of problems in the batch
+    int size() const;
+    /// iterations used to solve the i-th problem
+    int get_iterations(int) const;
+    /// number of constraints of the i-th problem
+    int get_num_constraints(int) const;
+    /// copy solved weights back to the original problems
+    void unpack() const;
+  };
 
 
   ////////////////////////////////////////////////////////////////
@@ -153,16 +293,20 @@
     double ScaleFactor;
     /// epsilon value to decide whether or not an iteration has caused relevant weight changes
     double Epsilon;
+    /// weight floor under which labels are pruned (0 means no pruning)
+    double PruneFloor;
 
     /// private methods
     double NormalizeSupport(double) const;
 
   public:
     /// Constructor
-    relax(int, double, double);
+    relax(int, double, double, double prune=0.0);
 
-    /// solve consistent labelling problem
-    void solve(problem &) const;
+    /// solve consistent labelling problem, return number of iterations used
+    int solve(problem &) const;
+    /// solve a batch of problems together
+    void solve(problem_batch &) const;
     /// change scale factor 
     void set_scale_factor(double);
   };
@@ -0,0 +1,144 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <cstdlib>
+#include <cstring>
+
+#include "rlalign.h"
+#include "aligner.h"
+#include "traces.h"
+
+using namespace std;
+
+struct rl_model {
+  model m;
+  rl_model(const string &basename, const string &fconfig) : m(basename, fconfig) {}
+};
+
+struct rl_aligner {
+  aligner a;
+  rl_aligner(const model &m) : a(m) {}
+};
+
+/// message of the last error in the calling thread
+static thread_local string last_error;
+
+/// record an error, returning given failure value
+template<class T> static T failed(const string &msg, T value) {
+  last_error = msg;
+  return value;
+}
+
+/// copy a string into malloc'ed memory, so C callers can free it
+static char *c_string(const string &s) {
+  char *c = (char*)malloc(s.size()+1);
+  if (c!=NULL) memcpy(c, s.c_str(), s.size()+1);
+  return c;
+}
+
+/// check that a trace given by a C caller has n events, all of them given
+static bool valid_trace(const char *const *events, int n) {
+  if (n<0 or (n>0 and events==NULL)) return false;
+  for (int i=0; i<n; ++i) 
+    if (events[i]==NULL) return false;
+  return true;
+}
+
+rl_model *rl_model_load(const char *basename, const char *fconfig) {
+  // library errors must not end the host program, they are turned into failures below
+  traces::ThrowErrors = true;
+
+  if (basename==NULL or fconfig==NULL) return failed("missing model or config name", (rl_model*)NULL);
+  if (not model::available(basename, fconfig)) 
+    return failed(string("cannot read model files ") + basename + ".* or config file " + fconfig, (rl_model*)NULL);
+  try { 
+    rl_model *m = new rl_model(basename, fconfig); 
+    string err = m->m.check();
+    if (err.empty()) return m;
+    delete m;
+    return failed(string("invalid model ") + basename + ": " + err, (rl_model*)NULL);
+  }
+  catch (std::exception &e) { return failed(e.what(), (rl_model*)NULL); }
+}
+
+void rl_model_free(rl_model *m) {
+  delete m;
+}
+
+rl_aligner *rl_aligner_new(const rl_model *m) {
+  if (m==NULL) return failed("missing model", (rl_aligner*)NULL);
+  try { return new rl_aligner(m->m); }
+  catch (std::exception &e) { return failed(e.what(), (rl_aligner*)NULL); }
+}
+
+void rl_aligner_free(rl_aligner *a) {
+  delete a;
+}
+
+char *rl_align(rl_aligner *a, const char *const *events, int n, int *fitting) {
+  if (a==NULL) return failed("missing aligner", (char*)NULL);
+  if (not valid_trace(events, n)) return failed("invalid trace: negative length or missing events", (char*)NULL);
+  try {
+    vector<string> trace(events, events+n);
+    bool fits;
+    string solution = a->a.align(trace, fits).dump();
+    if (fitting!=NULL) *fitting = fits;
+    return c_string(solution);
+  }
+  catch (std::exception &e) { return failed(e.what(), (char*)NULL); }
+}
+
+int rl_align_batch(rl_aligner *a, const char *const *const *traces, const int *lengths, int ntraces,
+                   char **results, int *fitting) {
+  if (a==NULL) return failed("missing aligner", -1);
+  if (results==NULL or ntraces<0 or (ntraces>0 and (traces==NULL or lengths==NULL))) 
+    return failed("missing traces, lengths or results", -1);
+  for (int i=0; i<ntraces; ++i) 
+    if (not valid_trace(traces[i], lengths[i])) 
+      return failed("invalid trace " + to_string(i) + ": negative length or missing events", -1);
+  try {
+    vector<vector<string> > batch(ntraces);
+    for (int i=0; i<ntraces; ++i) batch[i].assign(traces[i], traces[i]+lengths[i]);
+
+    vector<bool> fits;
+    vector<alignment> solution = a->a.align(batch, fits);
+    for (int i=0; i<ntraces; ++i) {
+      results[i] = c_string(solution[i].dump());
+      if (fitting!=NULL) fitting[i] = fits[i];
+    }
+    return 0;
+  }
+  catch (std::exception &e) { return failed(e.what(), -1); }
+}
+
+void rl_free(char *s) {
+  free(s);
+}
+
+const char *rl_last_error(void) {
+  return last_error.c_str();
+}
@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __RLALIGN_H
+#define __RLALIGN_H
+
+////////////////////////////////////////////////////////////////
+///
+///  C interface to the aligner, to call it from other languages
+///  (e.g. through FFI) without running the align program.
+///  Models can be shared by several aligners, but each aligner
+///  must be used by only one thread at a time.
+///
+////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rl_model rl_model;
+typedef struct rl_aligner rl_aligner;
+
+/// load model files with given prefix (.bp.pnml, .tt.path, .tf.bp, .tt.bp)
+/// and configuration file. Returns NULL if they can not be loaded, or are
+/// not consistent.  Once a model is loaded, errors in the library are 
+/// reported by the functions below failing, instead of ending the program.
+rl_model *rl_model_load(const char *basename, const char *fconfig);
+/// release a model. Aligners using it must be released first.
+void rl_model_free(rl_model *m);
+
+/// create an aligner for a model. Returns NULL on failure
+rl_aligner *rl_aligner_new(const rl_model *m);
+/// release an aligner
+void rl_aligner_free(rl_aligner *a);
+
+/// align a trace of n events. Returns the alignment string (to be released 
+/// with rl_free), or NULL on failure. 'fitting' is set to 1 if it fits the model.
+char *rl_align(rl_aligner *a, const char *const *events, int n, int *fitting);
+/// align ntraces traces together, trace i having lengths[i] events.
+/// Alignment i is left in results[i] (to be released with rl_free), and 
+/// its fitness in fitting[i]. Returns 0 on success, -1 on failure.
+int rl_align_batch(rl_aligner *a, const char *const *const *traces, const int *lengths, int ntraces,
+                   char **results, int *fitting);
+/// release a string returned by the aligner
+void rl_free(char *s);
+
+/// message of the last failure in the calling thread (empty if none)
+const char *rl_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
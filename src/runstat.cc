@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "traces.h"
+#define MOD_TRACENAME "RUNSTAT"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// ===========================
+/// ========= MAIN ============
+/// ===========================
+
+/// Runs a command, and writes its wall time (seconds) and peak resident
+/// memory (KB, as reported by wait4 for the command and its children)
+/// to a file, in the same format as "time -f '%e %M'".
+
+int main(int argc, char *argv[]) {
+
+  if (argc<4 or string(argv[1])!="-o") {
+    ERROR_CRASH("Usage " << argv[0] << " -o statsfile command [args..]\n         Runs command, and writes 'wall-seconds peak-rss-KB' to statsfile. Exit status is that of the command.");
+  }
+
+  auto t0 = chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid<0) ERROR_CRASH("Error running " << argv[3] << ": " << strerror(errno));
+  if (pid==0) {
+    execvp(argv[3], argv+3);
+    cerr << MOD_TRACENAME << ": Error running " << argv[3] << ": " << strerror(errno) << endl;
+    _exit(127);
+  }
+
+  int status;
+  struct rusage ru;
+  while (wait4(pid, &status, 0, &ru)<0) 
+    if (errno!=EINTR) ERROR_CRASH("Error waiting for " << argv[3] << ": " << strerror(errno));
+  chrono::duration<double> wall = chrono::steady_clock::now() - t0;
+
+  ofstream out(argv[2]);
+  if (not out.good()) ERROR_CRASH("Error opening file " << argv[2]);
+  out.setf(ios::fixed);
+  out.precision(2);
+  out << wall.count() << " " << ru.ru_maxrss << endl;
+
+  if (WIFEXITED(status)) return WEXITSTATUS(status);
+  return 128+WTERMSIG(status);
+}
@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "stream.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "STREAM"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// Constructor, open the file and start reading it
+
+input_stream::input_stream(const string &fn) : fname(fn), finished(false), stopping(false) {
+  FILE *f = fopen(fname.c_str(), "rb");
+  if (f==NULL) ERROR_CRASH("Error opening file " << fname);
+  fclose(f);
+  reader = thread(&input_stream::run, this);
+}
+
+/// Destructor, stop the reader
+
+input_stream::~input_stream() {
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  consumed.notify_all();
+  reader.join();
+}
+
+/// format of a file, detected from its magic number
+
+input_stream::format_type input_stream::format(const string &fname) {
+  unsigned char magic[4] = {0,0,0,0};
+  FILE *f = fopen(fname.c_str(), "rb");
+  size_t n = (f==NULL ? 0 : fread(magic, 1, 4, f));
+  if (f!=NULL) fclose(f);
+
+  if (n==4 and magic[0]==0x28 and magic[1]==0xb5 and magic[2]==0x2f and magic[3]==0xfd) return ZSTD;
+  if (n>=2 and magic[0]==0x1f and magic[1]==0x8b) return GZIP;
+  return PLAIN;
+}
+
+/// reader thread loop: choose the reader from the file format
+
+void input_stream::run() {
+  format_type fmt = format(fname);
+
+  bool ok;
+  if (fmt==ZSTD) {
+    TRACE(2, "Reading zstd compressed file " << fname);
+    ok = read_zstd();
+  }
+  else {
+    // zlib reads plain files as they are
+    TRACE(2, "Reading " << (fmt==GZIP ? "gzip compressed" : "plain") << " file " << fname);
+    ok = read_gzip();
+  }
+
+  lock_guard<mutex> lock(mtx);
+  if (not ok and error.empty()) error = "Error reading file " + fname;
+  finished = true;
+  produced.notify_all();
+}
+
+/// queue a chunk, waiting if the consumer is too far behind
+
+bool input_stream::push(string &chunk) {
+  unique_lock<mutex> lock(mtx);
+  consumed.wait(lock, [this]{ return stopping or chunks.size()<MAX_CHUNKS; });
+  if (stopping) return false;
+  chunks.push_back(string());
+  chunks.back().swap(chunk);
+  produced.notify_one();
+  return true;
+}
+
+/// read a gzip (or plain) file
+
+bool input_stream::read_gzip() {
+  gzFile gz = gzopen(fname.c_str(), "rb");
+  if (gz==NULL) return false;
+  gzbuffer(gz, 256*1024);
+
+  bool ok = true;
+  string chunk;
+  while (true) {
+    chunk.resize(CHUNK_SIZE);
+    int n = gzread(gz, &chunk[0], CHUNK_SIZE);
+    if (n<0) {
+      int err;
+      error = "Error decompressing file " + fname + ": " + gzerror(gz, &err);
+      ok = false;
+      break;
+    }
+    if (n==0) {
+      // end of input: check it is the end of the stream, and not a truncated file
+      int err;
+      const char *msg = gzerror(gz, &err);
+      if (err!=Z_OK and err!=Z_STREAM_END) {
+        error = "Error decompressing file " + fname + ": " + msg;
+        ok = false;
+      }
+      break;
+    }
+    chunk.resize(n);
+    if (not push(chunk)) break;
+  }
+
+  gzclose(gz);
+  return ok;
+}
+
+/// read a zstd file
+
+bool input_stream::read_zstd() {
+#ifdef HAVE_ZSTD
+  FILE *f = fopen(fname.c_str(), "rb");
+  if (f==NULL) return false;
+
+  ZSTD_DStream *zs = ZSTD_createDStream();
+  ZSTD_initDStream(zs);
+  vector<char> in(ZSTD_DStreamInSize());
+
+  bool ok = true, stopped = false;
+  string chunk;
+  size_t n, ret = 0;
+  while (ok and not stopped and (n = fread(in.data(), 1, in.size(), f)) > 0) {
+    ZSTD_inBuffer zin = { in.data(), n, 0 };
+    while (zin.pos < zin.size) {
+      chunk.resize(CHUNK_SIZE);
+      ZSTD_outBuffer zout = { &chunk[0], chunk.size(), 0 };
+      ret = ZSTD_decompressStream(zs, &zout, &zin);
+      if (ZSTD_isError(ret)) {
+        error = "Error decompressing file " + fname + ": " + ZSTD_getErrorName(ret);
+        ok = false;
+        break;
+      }
+      chunk.resize(zout.pos);
+      if (not chunk.empty() and not push(chunk)) {
+        stopped = true;
+        break;
+      }
+    }
+  }
+  if (ok and not stopped and ret!=0) {
+    error = "Truncated zstd file " + fname;
+    ok = false;
+  }
+
+  ZSTD_freeDStream(zs);
+  fclose(f);
+  return ok;
+#else
+  error = "File " + fname + " is zstd compressed, but zstd support was not compiled in";
+  return false;
+#endif
+}
+
+/// get next chunk of decompressed data. Returns false at the end of the file
+
+bool input_stream::next(string &chunk) {
+  unique_lock<mutex> lock(mtx);
+  produced.wait(lock, [this]{ return finished or not chunks.empty(); });
+  if (chunks.empty()) {
+    if (not error.empty()) ERROR_CRASH(error);
+    return false;
+  }
+  chunk.swap(chunks.front());
+  chunks.pop_front();
+  consumed.notify_one();
+  return true;
+}
@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class input_stream reads a file in chunks, decompressing
+///  it on the fly if it is gzip (or zstd, if compiled with
+///  HAVE_ZSTD) compressed.  Format is detected from the file
+///  contents, so plain files are read as well.  Reading and
+///  decompression run on a separate thread, a few chunks ahead
+///  of the consumer, so they overlap with parsing and the whole
+///  decompressed file is never held in memory or on disk.
+///
+////////////////////////////////////////////////////////////////
+
+class input_stream {
+
+ private:
+   /// file to read
+   std::string fname;
+   /// chunks read and not consumed yet
+   std::deque<std::string> chunks;
+   /// set when the reader reached the end of the file, or failed
+   bool finished;
+   /// error message, if the reader failed
+   std::string error;
+   /// set when the stream is being destroyed
+   bool stopping;
+   /// reader thread
+   std::thread reader;
+   /// synchronization of the chunk queue
+   std::mutex mtx;
+   std::condition_variable produced, consumed;
+
+   /// reader thread loop
+   void run();
+   /// queue a chunk read from the file. Returns false if the stream is being destroyed
+   bool push(std::string &chunk);
+   /// readers for each format. Return false on error, leaving a message in 'error'
+   bool read_gzip();
+   bool read_zstd();
+
+ public:
+   /// file formats
+   typedef enum {PLAIN, GZIP, ZSTD} format_type;
+
+   /// chunk size, and number of chunks the reader may be ahead of the consumer
+   static const size_t CHUNK_SIZE = 1<<20;
+   static const size_t MAX_CHUNKS = 4;
+
+   /// Constructor, open the file and start reading it
+   input_stream(const std::string &fname);
+   /// Destructor, stop the reader
+   ~input_stream();
+
+   /// get next chunk of decompressed data. Returns false at the end of the file
+   bool next(std::string &chunk);
+
+   /// format of a file, detected from its magic number
+   static format_type format(const std::string &fname);
+};
+
+#endif
@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+
+#include "timeline.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "TIMELINE"
+#define MOD_TRACECODE MAIN_TRACE
+
+using namespace std;
+
+/// a recorded phase: name (a string literal), argument, and begin and end times
+struct timeline_event {
+  const char *name;
+  long arg;
+  uint64_t begin, end;
+};
+
+/// ring buffer of the events of a thread
+struct timeline_buffer {
+  int tid;
+  string name;
+  vector<timeline_event> events;
+  /// number of events recorded (the last 'events.size()' are kept)
+  uint64_t count;
+};
+
+atomic<bool> timeline::recording(false);
+
+/// buffers of all threads that recorded something. They are kept after
+/// their thread ends, so events of finished workers can still be saved
+static mutex buffers_mtx;
+static vector<unique_ptr<timeline_buffer> > buffers;
+static size_t buffer_capacity = 0;
+static chrono::steady_clock::time_point origin;
+
+/// buffer of the calling thread (NULL until it records its first event)
+static thread_local timeline_buffer *own = NULL;
+
+/// buffer of the calling thread, created on first use
+
+static timeline_buffer *own_buffer() {
+  if (own==NULL) {
+    lock_guard<mutex> lock(buffers_mtx);
+    buffers.push_back(unique_ptr<timeline_buffer>(new timeline_buffer()));
+    own = buffers.back().get();
+    own->tid = buffers.size();
+    own->name = (own->tid==1 ? "main" : "thread " + to_string(own->tid));
+    own->events.resize(buffer_capacity);
+    own->count = 0;
+  }
+  return own;
+}
+
+/// start recording
+
+void timeline::start(size_t capacity) {
+  buffer_capacity = std::max<size_t>(capacity, 1);
+  origin = chrono::steady_clock::now();
+  own_buffer();   // so the starting thread gets the first id
+  recording = true;
+}
+
+/// stop recording
+
+void timeline::stop() {
+  recording = false;
+}
+
+/// current time, in nanoseconds since recording started
+
+uint64_t timeline::now() {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-origin).count();
+}
+
+/// add a phase to the buffer of the calling thread, overwriting the oldest if full
+
+void timeline::record(const char *name, long arg, uint64_t begin, uint64_t end) {
+  timeline_buffer *b = own_buffer();
+  timeline_event &e = b->events[b->count % b->events.size()];
+  e.name = name;
+  e.arg = arg;
+  e.begin = begin;
+  e.end = end;
+  ++b->count;
+}
+
+/// name the calling thread
+
+void timeline::thread_name(const string &name) {
+  if (enabled()) own_buffer()->name = name;
+}
+
+/// write recorded events as Chrome trace "complete" events (begin time 
+/// and duration, in microseconds), plus the name of each thread
+
+void timeline::save(const string &fname) {
+  FILE *f = fopen(fname.c_str(), "w");
+  if (f==NULL) ERROR_CRASH("Error opening timeline file " << fname);
+
+  lock_guard<mutex> lock(buffers_mtx);
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  uint64_t dropped = 0;
+  for (auto &b : buffers) {
+    fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", 
+            first ? "" : ",\n", b->tid, b->name.c_str());
+    first = false;
+
+    size_t n = b->events.size();
+    uint64_t from = (b->count > n ? b->count-n : 0);
+    dropped += from;
+    for (uint64_t k=from; k<b->count; ++k) {
+      const timeline_event &e = b->events[k % n];
+      fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", 
+              e.name, b->tid, e.begin/1000.0, (e.end-e.begin)/1000.0);
+      if (e.arg>=0) fprintf(f, ",\"args\":{\"n\":%ld}", e.arg);
+      fprintf(f, "}");
+    }
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+
+  if (dropped>0) WARNING("WARNING: Timeline buffers were full, " << dropped << " oldest events were not saved.");
+}
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __TIMELINE_H
+#define __TIMELINE_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////
+///
+///  The class timeline records when each thread runs the phases
+///  of the alignment (loading, building, solving, gap filling,
+///  output...), to be seen as a timeline in chrome://tracing or
+///  Perfetto.  Each thread writes fixed size records in its own
+///  ring buffer, so recording takes no locks and no allocations,
+///  and only the most recent events are kept if it fills.
+///  While recording is off, a phase costs a single flag check.
+///
+///  A phase is recorded by a timeline::scope object, from its 
+///  construction to the end of the block:
+///      timeline::scope ts("solve", trace.size());
+///
+////////////////////////////////////////////////////////////////
+
+class timeline {
+
+ private:
+   /// whether events are being recorded
+   static std::atomic<bool> recording;
+
+   /// current time, in nanoseconds since recording started
+   static uint64_t now();
+   /// add a phase to the buffer of the calling thread
+   static void record(const char *name, long arg, uint64_t begin, uint64_t end);
+
+ public:
+   /// start recording, keeping up to given number of events per thread
+   static void start(size_t capacity=1<<18);
+   /// stop recording
+   static void stop();
+   /// check whether events are being recorded
+   static bool enabled() { return recording.load(std::memory_order_relaxed); }
+   /// name the calling thread in the timeline (e.g. "worker 3")
+   static void thread_name(const std::string &name);
+   /// write recorded events in Chrome trace event (JSON) format.
+   /// Recording threads must be idle while it is saved
+   static void save(const std::string &fname);
+
+   /// records a phase, with an optional numeric argument (e.g. trace length)
+   class scope {
+    private:
+      const char *name;
+      long arg;
+      uint64_t begin;
+    public:
+      scope(const char *n, long a=-1) : name(n), arg(a), begin(enabled() ? now()+1 : 0) {}
+      ~scope() { if (begin>0) record(name, arg, begin-1, now()); }
+   };
+};
+
+#endif
@@ -30,6 +30,15 @@
 
 int traces::Level = 0;
 unsigned long traces::Module = 0;
+std::atomic<bool> traces::ThrowErrors(false);
+
+/// report a fatal error: throw it (for library use), or print it and exit
+
+void traces::fail(const std::string &msg) {
+  if (ThrowErrors) throw std::runtime_error(msg);
+  std::cerr << msg << std::endl;
+  exit(1);
+}
 
 void traces::set_tracing(const std::string &trace) {
 
@@ -30,8 +30,11 @@
 #define _TRACES_H
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <list>
+#include <atomic>
+#include <stdexcept>
 #include <cstdlib>
 
 /// possible values for MOD_TRACECODE
@@ -41,6 +44,37 @@
 #define CFG_TRACE           0x00000008
 #define ALIGNMENT_TRACE     0x00000010
 #define RELAX_TRACE         0x00000020
+#define CACHE_TRACE         0x00000040
+
+/// Highest trace level compiled in, for all modules (default, all of them), 
+/// and for each module (default, TRACE_MAX_LEVEL).  Traces above it are
+/// removed at compile time, so e.g. -DTRACE_MAX_LEVEL=0 leaves no trace
+/// code in the inner loops of the solver, and -DRELAX_TRACE_MAX_LEVEL=-1 
+/// removes all traces of the relax module only.
+#ifndef TRACE_MAX_LEVEL
+#define TRACE_MAX_LEVEL 99
+#endif
+#ifndef MAIN_TRACE_MAX_LEVEL
+#define MAIN_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef GRAPH_TRACE_MAX_LEVEL
+#define GRAPH_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef BP_TRACE_MAX_LEVEL
+#define BP_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef CFG_TRACE_MAX_LEVEL
+#define CFG_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef ALIGNMENT_TRACE_MAX_LEVEL
+#define ALIGNMENT_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef RELAX_TRACE_MAX_LEVEL
+#define RELAX_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
+#ifndef CACHE_TRACE_MAX_LEVEL
+#define CACHE_TRACE_MAX_LEVEL TRACE_MAX_LEVEL
+#endif
 
 // MOD_TRACECODE and MOD_TRACENAME are empty. The class 
 // using the trace is expected to set them
@@ -48,6 +82,7 @@
 #undef MOD_TRACENAME
 
 #undef TRACE
+#undef TRACE_ENABLED
 #undef ERROR_CRASH
 #undef WARNING
 
@@ -63,13 +98,33 @@ class traces {
   static unsigned long Module;
 
   static void set_tracing(const std::string &trace);
+
+  /// whether fatal errors throw a std::runtime_error with the message instead 
+  /// of ending the program (set by code using the library in-process)
+  static std::atomic<bool> ThrowErrors;
+  /// report a fatal error: throw it, or print it and exit
+  [[noreturn]] static void fail(const std::string &msg);
+
+  /// highest trace level compiled in for a module (see TRACE_MAX_LEVEL)
+  static constexpr int max_level(unsigned long module) {
+    return module==MAIN_TRACE ? MAIN_TRACE_MAX_LEVEL :
+           module==GRAPH_TRACE ? GRAPH_TRACE_MAX_LEVEL :
+           module==BP_TRACE ? BP_TRACE_MAX_LEVEL :
+           module==CFG_TRACE ? CFG_TRACE_MAX_LEVEL :
+           module==ALIGNMENT_TRACE ? ALIGNMENT_TRACE_MAX_LEVEL :
+           module==RELAX_TRACE ? RELAX_TRACE_MAX_LEVEL :
+           module==CACHE_TRACE ? CACHE_TRACE_MAX_LEVEL :
+           TRACE_MAX_LEVEL;
+  }
 };
 
 
 /// Macros that must be used to put traces in the code.
 /// They may be either defined or null, depending on -DVERBOSE compilation flag. 
-#define ERROR_CRASH(msg) { std::cerr<<MOD_TRACENAME<<": "<<msg<<std::endl; \
-                           exit(1); \
+/// Errors end the program, or throw if traces::ThrowErrors is set.
+#define ERROR_CRASH(msg) { std::ostringstream err_msg; \
+                           err_msg<<MOD_TRACENAME<<": "<<msg; \
+                           traces::fail(err_msg.str()); \
                          }
  
 /// Warning macros. Compile without -DNO_WARNINGS (default) to get a code that warns about suspicious things.
@@ -82,16 +137,22 @@ class traces {
 
 /// Tracing macros. Compile with -DVERBOSE to get a traceable code.
 /// Compile without -DVERBOSE (default) to get faster, non-traceable, exploitation version.
+/// The message is only evaluated if the trace is printed.  TRACE_ENABLED
+/// guards code that only prepares a trace message (it is constant false 
+/// for levels not compiled in, so the compiler drops the guarded code).
 #ifdef VERBOSE   
 /// ifdef VERBOSE --> TRACE macros exists
 
-#define TRACE(lv,msg) { if (traces::Level>=lv && (traces::Module&MOD_TRACECODE)) { \
+#define TRACE_ENABLED(lv) (traces::max_level(MOD_TRACECODE)>=(lv) && traces::Level>=(lv) && (traces::Module&MOD_TRACECODE))
+
+#define TRACE(lv,msg) { if (TRACE_ENABLED(lv)) { \
                           std::cerr << MOD_TRACENAME << ": " << msg << std::endl;          \
                         }  \
                       }
                       
 #else
 /// ifndef VERBOSE --> No messages displayed. Faster code.
+#define TRACE_ENABLED(lv) false
 #define TRACE(x,y)
 #endif
 
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include "warmstart.h"
+#include "traces.h"
+
+#define MOD_TRACENAME "WARMSTART"
+#define MOD_TRACECODE RELAX_TRACE
+
+using namespace std;
+
+/// Constructor, create empty cache
+
+warm_start_cache::warm_start_cache() {}
+
+/// Destructor
+
+warm_start_cache::~warm_start_cache() {}
+
+
+/// seed initial weights of the longest cached prefix of the trace.
+/// Each label gets blend*initial + (1-blend)*cached, so labels that
+/// had died in the cached solution still get a chance to recover.
+
+int warm_start_cache::seed(problem &prb, const vector<uint32_t> &path, double blend) const {
+
+  // stored prefixes are closed under prefix, so stop at the first one not stored
+  size_t nv = 0;
+  while (nv<path.size() and path[nv]<weights.size() and not weights[path[nv]].empty()) {
+
+    const vector<pair<string,double> > &cached = weights[path[nv]];
+    for (int j=0; j<prb.get_num_labels(nv); ++j) {
+      // locate cached weight for this label (labels may have been pruned in the cached solution)
+      double w = 0;
+      string lname = prb.get_label_name(nv,j);
+      for (auto &c : cached) 
+        if (c.first == lname) { w = c.second; break; }
+      
+      prb.set_label_weight(nv, j, blend*prb.get_label_weight(nv,j) + (1-blend)*w);
+    }
+    ++nv;
+  }
+
+  TRACE(2, "Seeded " << nv << " of " << path.size() << " variables from cache");
+  return nv;
+}
+
+
+/// store converged weights of a solved problem, overwriting
+/// weights previously stored for the same prefixes.
+
+void warm_start_cache::store(const problem &prb, const vector<uint32_t> &path) {
+
+  for (size_t nv=0; nv<path.size(); ++nv) {
+    if (path[nv]>=weights.size()) weights.resize(path[nv]+1);
+
+    vector<pair<string,double> > &w = weights[path[nv]];
+    w.clear();
+    for (int j=0; j<prb.get_num_labels(nv); ++j)
+      w.push_back(make_pair(prb.get_label_name(nv,j), prb.get_label_weight(nv,j)));
+  }
+}
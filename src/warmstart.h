@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Affero General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.es)
+//             Computer Science Department
+//             Omega-320 - Campus Nord UPC
+//             C/ Jordi Girona 31
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#ifndef __WARMSTART_H
+#define __WARMSTART_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "relax.h"
+
+////////////////////////////////////////////////////////////////
+///
+///  The class warm_start_cache stores converged label weights
+///  of already solved traces on the nodes of the log prefix trie
+///  (see log.h), so that a new trace sharing a prefix with them
+///  can start the relaxation from those weights instead of from
+///  uniform ones.
+///
+////////////////////////////////////////////////////////////////
+
+class warm_start_cache {
+
+ private:
+   /// weights of the last variable of each trie node prefix (empty if not stored yet)
+   std::vector<std::vector<std::pair<std::string,double> > > weights;
+
+ public:
+   /// Constructor
+   warm_start_cache();
+   /// Destructor
+   ~warm_start_cache();
+
+   /// seed initial weights of the longest cached prefix of a trace, given
+   /// the trie nodes of its prefixes (trace_log::get_path).
+   /// Cached weights are blended with current ones using given factor.
+   /// Returns the number of seeded variables.
+   int seed(problem &prb, const std::vector<uint32_t> &path, double blend) const;
+   /// store converged weights of a solved problem
+   void store(const problem &prb, const std::vector<uint32_t> &path);
+};
+
+#endif